@@ -0,0 +1,40 @@
+#ifndef ASTFILE_H
+#define ASTFILE_H
+
+#include <string>
+#include <vector>
+#include "rose.h"
+#include "options.h"
+
+/**************************************************
+ * Saved frontend ASTs
+ * The AST the frontend builds for a command line
+ * is written with ROSE binary AST file I/O to
+ *		<AstDir>/<command line hash>.ast
+ * next to a .stamp file holding the input stamp
+ * (see GetInputStamp). A later run with the same
+ * stamp reads it back instead of parsing.
+ **************************************************/
+
+
+/****************************************
+ * Read the saved AST of a command line
+ * Return:
+ *		SgProject *: NULL if there is none
+ *			or its input changed
+ ****************************************/
+SgProject *
+LoadAst(const std::vector<std::string> &argvList, const std::string &stamp,
+		const Options &opts);
+
+
+/****************************************
+ * Save the AST of a command line, right
+ * after the frontend, before any change
+ ****************************************/
+void
+SaveAst(SgProject *project, const std::vector<std::string> &argvList,
+		const std::string &stamp, const Options &opts);
+
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include <vector>
+#include "options.h"
+
+/**************************************************
+ * Content-hashed translation cache
+ * An entry is keyed on the preprocessed input,
+ * the translator version and build, the profile
+ * and the output changing options. It holds the
+ * unparsed output (or a marker that nothing was
+ * unparsed), the group manifest and the XML
+ * config.
+ **************************************************/
+
+
+/****************************************
+ * 64 bit FNV-1a hash
+ ****************************************/
+unsigned long long
+HashStr(const std::string &str,
+		unsigned long long hash = 14695981039346656037ULL);
+
+
+/****************************************
+ * Hash as 16 hex digits
+ ****************************************/
+std::string
+HashHex(unsigned long long hash);
+
+
+/****************************************
+ * Source files on a frontend command line
+ ****************************************/
+std::vector<std::string>
+GetSrcFiles(const std::vector<std::string> &argvList);
+
+
+/****************************************
+ * File name ROSE unparses a source to
+ ****************************************/
+std::string
+GetUnparseFileName(const std::string &src);
+
+
+/****************************************
+ * Run the C preprocessor on the frontend
+ * command line
+ * Output:
+ *		string &text: preprocessed input
+ * Return:
+ *		bool: false if the preprocessor failed
+ ****************************************/
+bool
+Preprocess(const std::vector<std::string> &argvList, std::string &text);
+
+
+/****************************************
+ * Cache key of a command line, empty if
+ * it can NOT be cached (not exactly one
+ * source file, preprocessor failed)
+ ****************************************/
+std::string
+GetCacheKey(const std::vector<std::string> &argvList, const Options &opts);
+
+
+/****************************************
+ * Stamp of the frontend input: changes
+ * whenever the AST the frontend builds
+ * may change. Empty if the preprocessor
+ * failed.
+ ****************************************/
+std::string
+GetInputStamp(const std::vector<std::string> &argvList);
+
+
+/****************************************
+ * Copy a cached output to its unparse
+ * file name (and manifest, XML config)
+ * Output:
+ *		bool &unparsed: false if the cached
+ *		run unparsed nothing; a stale
+ *		rose_* file is then removed
+ * Return:
+ *		bool: true on a cache hit
+ ****************************************/
+bool
+CacheFetch(const std::string &key, const std::string &src,
+			const Options &opts, bool &unparsed);
+
+
+/****************************************
+ * Store the unparsed output (and manifest,
+ * XML config), or that nothing was
+ * unparsed
+ ****************************************/
+void
+CacheStore(const std::string &key, const std::string &src,
+			const Options &opts, bool unparsed);
+
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <string>
+#include <vector>
+#include "options.h"
+
+
+/**************************************************
+ * One translation unit handed to a worker
+ **************************************************/
+class Job
+{
+public:
+	std::string Dir;				// working directory, may be empty
+	std::string Src;				// source file
+	std::vector<std::string> Args;	// frontend arguments, no argv[0]
+	std::string Manifest;			// group manifest written by worker
+	std::string Patch;				// patch written by worker, may be empty
+	std::string Log;				// stdout/stderr of the worker
+};
+
+
+/**************************************************
+ * Driver mode: translate every file listed in
+ * opts.FileList or opts.CompDB in a pool of
+ * opts.Jobs worker processes, then merge the
+ * per-file group manifests (and patches)
+ * Input:
+ *		const vector<string> &argvList: frontend
+ *			arguments shared by every job
+ *		const Options &opts
+ * Return:
+ *		int: exit status, 0 if every job succeeded
+ **************************************************/
+int
+RunDriver(const std::vector<std::string> &argvList, const Options &opts);
+
+
+/**************************************************
+ * Read a file list, one source file per line,
+ * '#' starts a comment
+ **************************************************/
+void
+ReadFileList(const std::string &path,
+			const std::vector<std::string> &commonArgs,
+			std::vector<Job> &jobs);
+
+
+/**************************************************
+ * Read a compile_commands.json compilation
+ * database. The compiler of each entry is dropped,
+ * so are "-o <file>" pairs.
+ **************************************************/
+void
+ReadCompDB(const std::string &path,
+			const std::vector<std::string> &commonArgs,
+			std::vector<Job> &jobs);
+
+
+/**************************************************
+ * Merge per-file group manifests into one and
+ * report groups shared by several translation
+ * units
+ * Return:
+ *		int: number of cross-file groups
+ **************************************************/
+int
+MergeManifests(const std::vector<Job> &jobs, const std::string &path);
+
+
+#endif
@@ -11,6 +11,13 @@ enum FUNC
 	NC_PUT_VAR_FLOAT,
 	NC_PUT_VARA_INT,
 	NC_CLOSE,
+	NC_OPEN_PAR,
+	NC_INQ_VARID,
+	NC_GET_VARA_INT,
+	NC_GET_VARA_FLOAT,
+	NC_REDEF,
+	NC_SYNC,
+	NC_PUT_ATT_TEXT,
 	FUNC_SIZE	
 };
 
@@ -2,14 +2,17 @@
 #define GROUP_H
 
 #include <map>
+#include <set>
 #include <vector>
 #include <cstdio>
 #include "rose.h"
 #include "roseHelper.h"
 #include "func.h"
 #include "utils.h"
+#include "options.h"
 
 class VarSec;
+class ScanReport;
 
 class Group
 {
@@ -18,12 +21,15 @@ public:
 	/**********************************************
 	 * Constructor
 	 **********************************************/
-	Group(std::vector<SgFunctionCallExp*>, 
+	Group(const std::vector<SgFunctionCallExp*> &, 
 			const std::map<std::string, FUNC> &,
-			int id);
+			int id, const Options &opts);
 
 	void
-	InsertAdiosInit();
+	InsertAdiosInit(StmtBatch &batch);
+
+	void
+	Extract_nc_create_par();
 
 	void
 	Process_nc_create_par();
@@ -37,12 +43,98 @@ public:
 	void 
 	Process_nc_enddef();
 
+	void
+	Extract_nc_def_dim();
+
 	void
 	Extract_nc_def_var();
 
 	void
 	Extract_nc_put_vara_int();
 
+	void
+	Extract_nc_put_var_float();
+
+	void
+	Process_nc_put_var_float();
+
+	void
+	Process_nc_put_vara_int();
+
+	void
+	Process_nc_close();
+
+	void
+	Process_nc_redef();
+
+	void
+	Process_nc_sync();
+
+	void
+	Process_nc_put_att_text();
+
+	/**********************************************
+	 * Fuse the groups of several ncids into one
+	 * adios group and file, after Extract_*
+	 **********************************************/
+	static void
+	Fuse(const std::vector<Group*> &groupVec);
+
+	bool
+	IsReadGroup() const;
+
+	void
+	Extract_nc_open_par();
+
+	void
+	Extract_nc_inq_varid();
+
+	void
+	Process_nc_open_par();
+
+	void
+	Process_nc_inq_varid();
+
+	void
+	Process_nc_get_vara();
+
+	void
+	Process_nc_close_read();
+
+	std::string
+	GetName() const;
+
+	std::string
+	GetFileName() const;
+
+	std::string
+	GetSrcFileName() const;
+
+	/**********************************************
+	 * Write the adios-group and method elements
+	 * of an adios XML config
+	 **********************************************/
+	void
+	WriteXml(std::ostream &out) const;
+
+	/**********************************************
+	 * Analysis only, for scan mode
+	 * (defined in scan.cpp)
+	 **********************************************/
+	void
+	Scan(ScanReport &report);
+
+	/**********************************************
+	 * Var and dim tables of a standalone I/O
+	 * skeleton (defined in skeleton.cpp)
+	 * Output:
+	 *		vector<string> &entries: one
+	 *			nc2adios_skel_group initializer
+	 *			per adios group
+	 **********************************************/
+	void
+	WriteSkeleton(std::ostream &out, std::vector<std::string> &entries) const;
+
 
 	// void
 	// Process_nc_enddef();
@@ -58,48 +150,239 @@ private:
 	std::string FileName;
 	std::string GroupIDVar;
 	std::string FileVar;
+	std::string StatsName;			// companion group with statistics
+	std::string StatsFileName;
+	std::string StatsGroupIDVar;
+	std::string StatsFileVar;
+	std::string RankVar;			// MPI rank, for replicated vars
+	std::string RFileVar;			// ADIOS_FILE* of a read group
+	std::string StepVar;			// puts into the current piece
+	std::string PieceVar;			// number of the current piece
+	std::string BytesVar;			// data bytes in the current piece
+	int RolloverSteps;				// new piece every N puts, 0 = never
+	int RolloverMB;					// or after M MB of data, 0 = never
+	bool RolloverManifest;			// list the pieces in <file>.pieces
 	int Cmode;
 	int GroupID;
 	SgExpression *CommExp;
 	bool IsPara;
+	bool IsRead;					// opened by nc_open_par
+	bool StatsOn;
+	bool HasStatsGroup;
 	const std::map<std::string, FUNC> *FuncNameIndMap;
+	const Options *Opts;
+	std::vector<std::string> *ErrVec;	// scan: Extract_* errors, else quit
 	std::map<SgInitializedName*, std::vector<std::string> > DimMap;
 	std::map<SgInitializedName*, VarSec> VarMap;
+	std::map<SgInitializedName*, std::string> VarNameMap;	// read varids
+	std::set<std::string> ReducedDimSet;	// dims of decimated vars
+	std::map<std::string, int> IdMap;		// name -> ADIOS var ID slot
+	std::map<std::string, int> StatsIdMap;
+	int IdNum;
+	int StatsIdNum;
 	std::vector< std::vector<SgFunctionCallExp*> > CallVV;
+	std::map<SgFunctionCallExp*, int> CallSeq;	// order in the source
+	std::map<std::string, int> DimSeq;		// call that declares a dim
+	std::map<std::string, unsigned long long> DimLenMap;	// 0 = not constant
 	std::vector<SgInitializedName*> PutVarVec;
+	std::string Path;				// fused: namespace of adios names
+	Group *Leader;					// fused: declares the adios group
+	Group *Opener;					// fused: opens the file
+	Group *Closer;					// fused: closes it
+	std::vector<Group*> FusedVec;	// fused: all groups of the file
 
 
 	void 
 	FillIsPara();
 
+	void
+	FillStats();
+
+	void
+	FillRollover();
+
+	bool
+	HasRollover() const;
+
+	void
+	Error(const std::string &msg) const;
+
+	void
+	CheckRedefPairs() const;
+
+	std::string
+	AdPath(const std::string &name) const;
+
+	std::string
+	AdPathList(const std::string &list) const;
+
+	static int
+	GetLine(const std::vector<SgFunctionCallExp*> &vec, bool last);
+
+	SgExpression *
+	BuildFileNameExp(const std::string &fileName, bool list);
+
+	SgStatement *
+	BuildRollover(int seq);
+
+	SgExpression *
+	BuildOpenNameExp(const std::string &fileName, bool list);
+
+	void
+	AppendAdClose(SgBasicBlock *block, const std::string &fileVar,
+		const std::string &fileName, bool keep);
+
+	SgExprStatement *
+	BuildStageDrain(const std::string &fileName, bool keep);
+
+	void
+	AppendAdOpen(SgBasicBlock *block, const std::string &fileVar,
+		const std::string &name, const std::string &fileName,
+		const std::string &suffix, const std::string &mode, int seq);
+
+	bool
+	IsStatsVar(const std::string &name) const;
+
+	bool
+	InStatsGroup(const VarSec &var) const;
+
+	std::string
+	GetVarGroupIDVar(const VarSec &var) const;
+
+	std::string
+	GetVarFileVar(const VarSec &var) const;
+
+	bool
+	HasReplicated() const;
+
+	bool
+	HasReductions() const;
+
+	void
+	FillAnalysis(VarSec &var) const;
+
+	void
+	FillReduction(VarSec &var) const;
+
+	static std::string
+	GetRtTypeMacro(const std::string &typeStr);
+
+	static std::string
+	GetReductionMacro(const std::string &reduction);
+
+	SgExprStatement *
+	BuildAnalyze(const VarSec &var, const std::string &fileVar,
+		const std::vector<SgExpression*> &args);
+
+	SgExprStatement *
+	BuildAdWrite(const std::string &fileVar, const std::string &name,
+		SgExpression *data);
+
+	std::vector<SgExpression*>
+	InsertOmpPack(SgStatement *orginStmt, SgStatement *region, int ndims,
+		SgBasicBlock *block);
+
+	void
+	FillIds();
+
+	std::string
+	GetIdsVar(bool statsGroup) const;
+
+	SgExpression *
+	BuildIdRef(bool statsGroup, int slot);
+
+	void
+	WriteXmlGroup(std::ostream &out, const std::string &name, bool stats,
+		bool statsGroup) const;
+
+	void
+	WriteXmlVars(std::ostream &out, bool statsGroup) const;
+
+	std::string
+	GetMethod() const;
+
+	std::string
+	GetMethodParams() const;
+
+	int
+	GetBufferMB() const;
+
+	std::string
+	GetStageDir() const;
+
+	bool
+	IsStaged() const;
+
 	SgExprStatement *
 	BuildAdInit();
 
 	SgExprStatement *
-	BuildAdAllocBuf();
+	BuildAdDeclGroup(const std::string &groupVar, const std::string &name,
+		bool stats);
 
 	SgExprStatement *
-	BuildAdDeclGroup();
+	BuildAdSelMod(const std::string &groupVar);
 
 	SgExprStatement *
-	BuildAdSelMod();
+	BuildAdOpen(const std::string &fileVar, const std::string &name,
+		const std::string &fileName, const std::string &mode = "w");
+
 
 	SgExprStatement *
-	BuildAdOpen();
+	BuildGroupSizeAssign(const std::string &groupVarName, bool statsGroup);
 
+	std::vector<const VarSec*>
+	GetVarOrder(bool statsGroup) const;
+
+	std::vector<std::string>
+	GetAllDims() const;
+
+	int
+	GetSeq(SgFunctionCallExp *callExp) const;
+
+	std::vector<std::string>
+	GetDimsBetween(int low, int high) const;
+
+	SgStatement *
+	InsertDimWrites(SgStatement *prevStmt, const std::string &fileVar,
+		int low, int high, StmtBatch &batch);
+
+	std::string
+	GetVarTableVar(const std::string &suffix) const;
+
+	SgVariableDeclaration *
+	BuildVarTable(const std::string &suffix, bool statsGroup);
 
 	SgExprStatement *
-	BuildGroupSizeAssign(const std::string &groupVarName);
+	BuildDefineVars(const std::string &groupVar, const std::string &suffix,
+		bool statsGroup);
+
+	SgStatement *
+	InsertGroupSizeTable(SgStatement *prevStmt, 
+		const std::string &groupSizeVarName, const std::string &suffix,
+		bool statsGroup, StmtBatch &batch);
 
 	SgExprStatement *
-	BuildAdGroupSize(const std::string &groupSizeVarName, 
+	BuildAdGroupSize(const std::string &fileVar,
+						const std::string &groupSizeVarName, 
 						const std::string &totalSizeVarName);
 
+	SgStatement *
+	InsertGroupSize(SgStatement *prevStmt, const std::string &suffix,
+		bool statsGroup, StmtBatch &batch);
+
+	SgStatement *
+	InsertAdOpen(SgStatement *prevStmt, const std::string &fileVar,
+		const std::string &name, const std::string &fileName,
+		const std::string &suffix, bool statsGroup, int seq,
+		StmtBatch &batch);
+
 
 	SgExprStatement *
-	BuildAdDefVar(const std::string &varName, const std::string &typeName,
+	BuildAdDefVar(const std::string &groupVar,
+		const std::string &varName, const std::string &typeName,
 		const std::string &count = std::string(), const std::string &global = std::string(), 
-		const std::string &offset = std::string());
+		const std::string &offset = std::string(), int slot = -1);
 
 
 	
@@ -114,7 +397,7 @@ private:
 	 *		vector< vector<SgFunctionCallExp*> > CallVV
 	 **************************************************/
 	void 
-	InitCallVV(std::vector<SgFunctionCallExp*>);
+	InitCallVV(const std::vector<SgFunctionCallExp*> &vec);
 
 	/*********************************************
 	  * Extract info from nc_create function calls
@@ -128,27 +411,18 @@ private:
 	  *		int Cmode: nc create mode
 	  *******************************************/
 	void
-	Extract_nc_create(std::vector<SgFunctionCallExp*>);
+	Extract_nc_create(const std::vector<SgFunctionCallExp*> &vec);
 
 
 
-	/**********************************************
-	 * Extract info from nc_def_dim function calls
-	 * Input:
-	 *		vector<SgFunctionCallExp*> vec:
-	 *			nc_def_dim call vector
-	 * Output:
-	 *		map<SgInitializedName*, string> DimMap:
-	 *			dim info 
-	 **********************************************/
-	void
-	Extract_nc_def_dim(std::vector<SgFunctionCallExp*>);
+	std::string
+	ExtractOne_nc_def_dim(SgFunctionCallExp *callExp);
 
 	void 
-	ProcessOne_nc_def_dim(SgFunctionCallExp *callExp);
+	ProcessOne_nc_def_dim(SgFunctionCallExp *callExp, StmtBatch &batch);
 
 	void 
-	ProcessOne_nc_def_var(SgFunctionCallExp *callExp);
+	ProcessOne_nc_def_var(SgFunctionCallExp *callExp, StmtBatch &batch);
 
 	void 
 	ExtractOne_nc_def_var(SgFunctionCallExp *callExp);
@@ -175,18 +449,42 @@ public:
 	VarSec(SgInitializedName *initName, std::vector<std::string> vec, 
 		std::string name, std::string typeStr, int unitSize):
 			InitName(initName), CountInit(NULL), OffsetInit(NULL),
-			StrVec(vec), Name(name), TypeStr(typeStr), UnitSize(unitSize), 
-			IterNum(0), IsGlobal(false)  {}
+			StrVec(vec), Name(name), TypeStr(typeStr), MemTypeStr(typeStr),
+			UnitSize(unitSize), IterNum(0), IsGlobal(false), 
+			IsReplicated(false), Stats(false), Analyze(false), Stride(1),
+			IdBase(-1)  {}
 
 	SgInitializedName *InitName;		// for dimids
 	SgInitializedName *CountInit;
 	SgInitializedName *OffsetInit;
 	std::vector<std::string> StrVec;
 	std::string Name;
-	std::string TypeStr;
+	std::string TypeStr;			// stored in the file
+	std::string MemTypeStr;			// of the put buffer
 	int UnitSize;
 	int IterNum;
 	bool IsGlobal;
+	bool IsReplicated;				// held in full by every rank
+	bool Stats;						// profile stats_var
+	bool Analyze;					// profile analysis
+	std::vector<std::string> Reductions;
+	int Stride;						// profile decimate
+	int IdBase;						// first of its ADIOS var ID slots
+
+	/***** Dim names of the stored var: <dim>_d<D>
+			if decimated *****/
+	std::vector<std::string>
+	GetDimVec() const
+	{
+		if (Stride == 1)
+			return StrVec;
+		char suffix[30];
+		snprintf(suffix, 30, "_d%d", Stride);
+		std::vector<std::string> vec(StrVec);
+		for (std::vector<std::string>::size_type i = 0; i < vec.size(); ++i)
+			vec[i] += suffix;
+		return vec;
+	}
 
 
 };
@@ -0,0 +1,75 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+#include "profile.h"
+
+#define NC2ADIOS_VERSION "0.2.0"
+
+/**************************************************
+ * Command line options of the translator itself.
+ * They all start with "-nc2adios:" and are removed
+ * from the argument list before it is handed to
+ * the ROSE frontend.
+ **************************************************/
+class Options
+{
+public:
+	Options(): Jobs(0), Scan(false), Tables(false) {}
+
+	std::string FileList;		// driver: one source file per line
+	std::string CompDB;			// driver: compile_commands.json
+	int Jobs;					// driver: worker processes, 0 = cores
+	std::string Manifest;		// group manifest to write
+	std::string CacheDir;		// translation cache, empty = off
+	std::string AstDir;			// saved frontend ASTs, empty = off
+	std::string ServerSocket;	// translation server socket
+	bool Scan;					// analysis only, no translation
+	std::string XmlFile;		// external adios XML config, empty = noxml
+	bool Tables;				// var descriptor tables + runtime loops
+	std::string SkeletonFile;	// standalone I/O skeleton to write
+	std::string PatchFile;		// unified diff instead of rose_* files
+	std::string PatchBase;		// patch paths relative to it, empty =
+								// directory of PatchFile
+	Profile Prof;				// translation profile
+
+	/* Options that change the translated output,
+	 * part of the translation cache key */
+	std::vector<std::string> KeyOpts;
+
+	/* Options handed on to driver workers */
+	std::vector<std::string> WorkerOpts;
+};
+
+
+/**************************************************
+ * Strip "-nc2adios:" options off argvList
+ * Input:
+ *		vector<string> &argvList: full command line
+ * Output:
+ *		vector<string> &argvList: command line for
+ *			the ROSE frontend
+ *		Options &opts: parsed options
+ **************************************************/
+void
+ParseOptions(std::vector<std::string> &argvList, Options &opts);
+
+
+/**************************************************
+ * Is arg a "-nc2adios:" option that takes no
+ * value (-nc2adios:scan, -nc2adios:tables)?
+ **************************************************/
+bool
+IsFlagOption(const std::string &arg);
+
+
+/**************************************************
+ * Absolute form of a path, relative to the
+ * current directory
+ **************************************************/
+std::string
+AbsPath(const std::string &path);
+
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**************************************************
+ * Translation profile
+ * A text file, one setting per line:
+ *		key value [value ...]
+ * '#' starts a comment. A key may appear on
+ * several lines, e.g. once per group or variable.
+ **************************************************/
+class Profile
+{
+public:
+	typedef std::vector<std::string> Entry;
+
+	/**********************************************
+	 * Read the profile, quit if it can NOT be read
+	 **********************************************/
+	void
+	Load(const std::string &path);
+
+	/**********************************************
+	 * Raw text, part of the translation cache key
+	 **********************************************/
+	const std::string &
+	GetText() const;
+
+	/**********************************************
+	 * All entries of a key, in file order
+	 **********************************************/
+	const std::vector<Entry> &
+	GetAll(const std::string &key) const;
+
+	/**********************************************
+	 * First value of the last entry of a key,
+	 * def if the key is absent
+	 **********************************************/
+	std::string
+	GetStr(const std::string &key, const std::string &def) const;
+
+	int
+	GetInt(const std::string &key, int def) const;
+
+	/**********************************************
+	 * All values of the last entry of a key,
+	 * joined by blanks
+	 **********************************************/
+	std::string
+	GetLine(const std::string &key, const std::string &def) const;
+
+private:
+	std::string Text;
+	std::map<std::string, std::vector<Entry> > EntryMap;
+
+};
+
+
+#endif
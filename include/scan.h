@@ -0,0 +1,80 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <ostream>
+#include "rose.h"
+#include "func.h"
+#include "options.h"
+
+/**************************************************
+ * Result of an analysis-only scan: NetCDF call
+ * sites, groups, variables, and every construct
+ * that keeps the translator from handling them
+ **************************************************/
+class ScanReport
+{
+public:
+	ScanReport(): GroupNum(0), GoodGroupNum(0), DimNum(0), VarNum(0) {}
+
+	void
+	AddCall(const std::string &funcName, bool supported);
+
+	void
+	AddBlock(SgFunctionCallExp *callExp, const std::string &reason);
+
+	void
+	AddNote(SgFunctionCallExp *callExp, const std::string &note);
+
+	void
+	AddGroup(const std::string &desc, bool ok);
+
+	void
+	Print(std::ostream &out) const;
+
+	int GroupNum;
+	int GoodGroupNum;
+	int DimNum;
+	int VarNum;
+
+private:
+	std::map<std::string, int> SupportedMap;
+	std::map<std::string, int> UnsupportedMap;
+	std::vector<std::string> BlockVec;
+	std::vector<std::string> NoteVec;
+	std::vector<std::string> GroupVec;
+
+	static std::string
+	Where(SgFunctionCallExp *callExp);
+};
+
+
+/**************************************************
+ * Check that the arguments of a supported NetCDF
+ * call have a shape the translator handles
+ * Output:
+ *		string &note: something worth reporting
+ *			that does not block translation
+ * Return:
+ *		string: why the call blocks translation,
+ *			empty if it does not
+ **************************************************/
+std::string
+CheckCall(SgFunctionCallExp *callExp, FUNC func, std::string &note);
+
+
+/**************************************************
+ * Scan mode: classify every NetCDF call, run the
+ * Extract_* analysis on every group and print a
+ * coverage report. The AST is not modified and
+ * the scan never quits early.
+ **************************************************/
+void
+ScanProject(SgProject *project,
+			const std::map<std::string, FUNC> &funcNameIndMap,
+			const Options &opts);
+
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include <vector>
+#include "options.h"
+
+/**************************************************
+ * Translation server
+ * The server stays resident on a unix socket. A 
+ * job is a request from nc2adios-client:
+ *		cwd '\0' argv[0] '\0' argv[1] '\0' ...
+ * terminated by the client shutting down writing.
+ * For each job the server forks a copy of itself,
+ * already loaded and initialized, which changes
+ * to cwd and translates argv as a command line of
+ * its own. The job's output goes back on the
+ * socket, followed by a last line
+ *		@nc2adios-exit <status>
+ **************************************************/
+
+#define NC2ADIOS_EXIT_TAG "@nc2adios-exit "
+
+
+typedef int (*TranslateFunc)(std::vector<std::string> &argvList,
+							const Options &opts);
+
+
+/**************************************************
+ * Serve jobs on opts.ServerSocket, never returns
+ * unless the socket can NOT be set up
+ * Input:
+ *		TranslateFunc translate: translates one
+ *			job command line, after its options
+ *			were parsed
+ **************************************************/
+int
+RunServer(const Options &opts, TranslateFunc translate);
+
+
+#endif
@@ -2,6 +2,7 @@
 #define UTILS_H
 
 #include <map>
+#include <set>
 #include <vector>
 #include "rose.h"
 #include "roseHelper.h"
@@ -22,16 +23,77 @@ int
 GetEnumIntVal(SgEnumDeclaration *decl, const std::string &name);
 
 
+/*****************************************
+ * Get the value of an ADIOS enum constant
+ * from the built-in table
+ ******************************************/
+bool
+GetAdiosEnumVal(const std::string &enumType, 
+		const std::string &enumConstant, int &val);
+
+
 /*****************************************
  * Get the expression of an enum constant
+ * adios.h need NOT be in the AST
  ******************************************/
 SgExpression *
 GetEnumExpr(const std::string &enumType, const std::string &enumConstant);
 
 
+/*****************************************
+ * #include "adios.h" in the file of stmt
+ * if adios.h was NOT parsed
+ ******************************************/
+void
+InsertAdiosHeader(SgStatement *stmt);
+
+
+/*****************************************
+ * #include "nc2adios_rt.h" in the file of
+ * stmt, for calls into the runtime
+ ******************************************/
+void
+InsertRuntimeHeader(SgStatement *stmt);
+
+
+/*****************************************
+ * #include <omp.h> in the file of stmt,
+ * for omp_get_thread_num
+ ******************************************/
+void
+InsertOmpHeader(SgStatement *stmt);
+
+
+/*****************************************
+ * Statement of the innermost OpenMP
+ * parallel region (#pragma omp parallel
+ * ...) around stmt, NULL if none
+ ******************************************/
+SgStatement *
+GetOmpRegion(SgStatement *stmt);
+
+
+/*****************************************
+ * Argument of the num_threads clause of
+ * the pragma of a region, empty if none
+ ******************************************/
+std::string
+GetOmpNumThreads(SgStatement *region);
+
+
+/*****************************************
+ * Loop that repeats a put: the one around
+ * the OpenMP parallel region of stmt if
+ * there is one, else the one around stmt.
+ * NULL if that is not a for loop.
+ ******************************************/
+SgForStatement *
+GetPutLoop(SgStatement *stmt);
+
+
 /*************************************
  * Return the type define declaration
- * for MPI_Comm
+ * for MPI_Comm, NULL if there is none
  ************************************/
 SgTypedefDeclaration *
 Get_MPI_Comm_Declaration(SgNode *node = NULL);
@@ -62,11 +124,15 @@ HasNcPrefix(const std::string &funcName);
 
 /****************************************
  * Only leave supported NetCDF calls
+ * Quit on an unsupported NetCDF call,
+ * unless unsupported is given, then it
+ * collects them
  ****************************************/
 void
 FilterCall(Rose_STL_Container<SgNode *>&callList,
 			std::vector<SgFunctionCallExp *> &ncCall, 
-			const std::map<std::string, FUNC> &nameIndMap);
+			const std::map<std::string, FUNC> &nameIndMap,
+			std::vector<SgFunctionCallExp *> *unsupported = NULL);
 
 
 /************************************
@@ -85,7 +151,7 @@ GroupNcCall(std::vector<SgFunctionCallExp*> &callVec,
 void
 GroupNcCallNow(std::vector<SgFunctionCallExp*> &callVec, 
 			std::vector< std::vector<SgFunctionCallExp*> > &callGroupVec,
-			std::map<SgInitializedName*, int>ncidMap);
+			const std::map<SgInitializedName*, int> &ncidMap);
 
 
 /********************************************
@@ -127,8 +193,58 @@ BuildCanonicalForStmtDeclOut(int start, int end, std::string indexName);
 void
 ExtractForStmtBounds(SgForStatement *forStmt, int &low, int &high);
 
+bool
+IsCanonicalForStmt(SgForStatement *forStmt);
+
+std::string
+MakeStr(const std::vector<std::string> &strVec, const std::string &prefix);
+
+/*****************************************
+ * Type name in an adios XML config for an
+ * ADIOS_DATATYPES constant, e.g.
+ * adios_unsigned_long -> "unsigned long"
+ *****************************************/
 std::string
-MakeStr(std::vector<std::string> strVec, std::string delimiter);
+GetXmlTypeName(const std::string &enumConstant);
+
+
+/*****************************************
+ * Statement edits batched per basic block.
+ * insertStatementAfter and removeStatement
+ * look the anchor up in the statement list
+ * of its block, so one call per emitted
+ * statement is quadratic in the block size.
+ * Edits are recorded here and Flush
+ * rebuilds each block once. Anchors may be
+ * statements inserted by the batch.
+ *****************************************/
+class StmtBatch
+{
+public:
+	/***** stmt right after anchor and the
+			statements inserted after it so far *****/
+	void
+	InsertAfter(SgStatement *anchor, SgStatement *stmt);
+
+	void
+	Remove(SgStatement *stmt);
+
+	void
+	Replace(SgStatement *stmt, SgStatement *newStmt);
+
+	void
+	Flush();
+
+private:
+	void
+	Emit(SgStatement *stmt, SgStatementPtrList &list, 
+		std::vector<SgStatement*> &orphanVec);
+
+	std::map<SgStatement*, std::vector<SgStatement*> > AfterMap;
+	std::set<SgStatement*> RemoveSet;
+	std::set<SgStatement*> NewSet;
+	std::vector<SgStatement*> AnchorVec;	// in the AST, in edit order
+};
 
 
 #endif
@@ -0,0 +1,162 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "nc2adios_rt.h"
+
+
+static void *
+Grow(void *ptr, size_t bytes)
+{
+	ptr = realloc(ptr, bytes);
+	if (ptr == NULL) {
+		fprintf(stderr, "nc2adios: can NOT allocate %lu bytes\n", 
+			(unsigned long)bytes);
+		abort();
+	}
+	return ptr;
+}
+
+
+static size_t
+Elements(const size_t *count, int ndims)
+{
+	size_t n = 1;
+	int i;
+
+	for (i = 0; i < ndims; ++i)
+		n *= count[i];
+	return n;
+}
+
+
+void
+nc2adios_omp_begin(nc2adios_omp_buf *buf, int nthreads, int ndims,
+	size_t size)
+{
+	int i;
+
+	if (ndims > NC2ADIOS_MAX_DIMS) {
+		fprintf(stderr, "nc2adios: %d dims, at most %d\n", ndims,
+			NC2ADIOS_MAX_DIMS);
+		abort();
+	}
+	if (nthreads > buf->nslots) {
+		buf->slots = (nc2adios_omp_slot *)Grow(buf->slots, 
+			nthreads * sizeof(nc2adios_omp_slot));
+		memset(buf->slots + buf->nslots, 0, 
+			(nthreads - buf->nslots) * sizeof(nc2adios_omp_slot));
+		buf->nslots = nthreads;
+	}
+	for (i = 0; i < buf->nslots; ++i) {
+		buf->slots[i].ntiles = 0;
+		buf->slots[i].bytes = 0;
+	}
+	buf->ndims = ndims;
+	buf->size = size;
+}
+
+
+void
+nc2adios_omp_pack(nc2adios_omp_buf *buf, int thread, const size_t *start,
+	const size_t *count, const void *data)
+{
+	nc2adios_omp_slot *slot;
+	size_t bytes = Elements(count, buf->ndims) * buf->size;
+	int nd = buf->ndims;
+
+	if (thread < 0 || thread >= buf->nslots) {
+		fprintf(stderr, "nc2adios: thread %d of %d in a put region\n",
+			thread, buf->nslots);
+		abort();
+	}
+	slot = &buf->slots[thread];
+
+	if (slot->ntiles == slot->maxTiles) {
+		slot->maxTiles = slot->maxTiles ? 2 * slot->maxTiles : 4;
+		slot->start = (size_t *)Grow(slot->start, 
+			slot->maxTiles * nd * sizeof(size_t));
+		slot->count = (size_t *)Grow(slot->count, 
+			slot->maxTiles * nd * sizeof(size_t));
+	}
+	if (slot->bytes + bytes > slot->maxBytes) {
+		slot->maxBytes = 2 * (slot->bytes + bytes);
+		slot->data = (char *)Grow(slot->data, slot->maxBytes);
+	}
+
+	memcpy(slot->start + slot->ntiles * nd, start, nd * sizeof(size_t));
+	memcpy(slot->count + slot->ntiles * nd, count, nd * sizeof(size_t));
+	memcpy(slot->data + slot->bytes, data, bytes);
+	slot->ntiles++;
+	slot->bytes += bytes;
+}
+
+
+void *
+nc2adios_omp_end(nc2adios_omp_buf *buf, size_t *start, size_t *count)
+{
+	size_t hi[NC2ADIOS_MAX_DIMS], idx[NC2ADIOS_MAX_DIMS];
+	size_t total = 0, row, off;
+	int nd = buf->ndims, last = nd - 1, first = 1;
+	int i, t, d;
+
+	/***** Bounding box of all tiles *****/
+	for (d = 0; d < nd; ++d)
+		start[d] = hi[d] = 0;
+	for (i = 0; i < buf->nslots; ++i)
+		for (t = 0; t < buf->slots[i].ntiles; ++t) {
+			const size_t *s = buf->slots[i].start + t * nd;
+			const size_t *c = buf->slots[i].count + t * nd;
+			for (d = 0; d < nd; ++d) {
+				if (first || s[d] < start[d])
+					start[d] = s[d];
+				if (first || s[d] + c[d] > hi[d])
+					hi[d] = s[d] + c[d];
+			}
+			total += Elements(c, nd);
+			first = 0;
+		}
+	for (d = 0; d < nd; ++d)
+		count[d] = hi[d] - start[d];
+
+	if (total != Elements(count, nd)) {
+		fprintf(stderr, "nc2adios: the tiles of a put region do NOT "
+			"cover their block\n");
+		abort();
+	}
+	if (total * buf->size > buf->maxBytes) {
+		buf->maxBytes = total * buf->size;
+		buf->block = (char *)Grow(buf->block, buf->maxBytes);
+	}
+	if (total == 0)
+		return buf->block;
+
+	/***** Each tile row by row into the block *****/
+	for (i = 0; i < buf->nslots; ++i) {
+		const char *src = buf->slots[i].data;
+		for (t = 0; t < buf->slots[i].ntiles; ++t) {
+			const size_t *s = buf->slots[i].start + t * nd;
+			const size_t *c = buf->slots[i].count + t * nd;
+			if (Elements(c, nd) == 0)
+				continue;
+			row = c[last] * buf->size;
+			for (d = 0; d < nd; ++d)
+				idx[d] = 0;
+			for (;;) {
+				off = 0;
+				for (d = 0; d < nd; ++d)
+					off = off * count[d] + (s[d] - start[d] + 
+						(d < last ? idx[d] : 0));
+				memcpy(buf->block + off * buf->size, src, row);
+				src += row;
+				for (d = last - 1; d >= 0; --d) {
+					if (++idx[d] < c[d])
+						break;
+					idx[d] = 0;
+				}
+				if (d < 0)
+					break;
+			}
+		}
+	}
+	return buf->block;
+}
@@ -0,0 +1,556 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <float.h>
+#include "nc2adios_rt.h"
+
+
+/***** nc2adios_init state *****/
+static int InitDone = 0;
+static int InitRank = 0;
+
+
+/**************************************************
+ * MPI_COMM_SELF attribute delete callback, called
+ * first thing in MPI_Finalize
+ **************************************************/
+static int
+FinalizeAdios(MPI_Comm comm, int keyval, void *attr, void *extra)
+{
+	(void)comm; (void)attr; (void)extra;
+	adios_finalize(InitRank);
+	MPI_Comm_free_keyval(&keyval);
+	return MPI_SUCCESS;
+}
+
+
+int
+nc2adios_init(const char *xml, MPI_Comm comm, unsigned long long buffer_mb)
+{
+	int keyval, err;
+
+	if (InitDone)
+		return 0;
+	InitDone = 1;
+	MPI_Comm_rank(comm, &InitRank);
+
+	if (xml != NULL) {
+		err = adios_init(xml, comm);
+	} else {
+		err = adios_init_noxml(comm);
+		if (err == 0)
+			err = adios_allocate_buffer(ADIOS_BUFFER_ALLOC_NOW, buffer_mb);
+	}
+	if (err != 0)
+		return err;
+
+	MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, FinalizeAdios, &keyval,
+		NULL);
+	MPI_Comm_set_attr(MPI_COMM_SELF, keyval, NULL);
+	return 0;
+}
+
+
+/**************************************************
+ * Block of the step that is the requested box,
+ * among the nblocks/size blocks `rank` wrote: every
+ * rank puts the same number of blocks per step
+ * (IterNum), in rank order
+ * Return:
+ *		int: write block index in the step, -1 if
+ *			none
+ **************************************************/
+static int
+FindOwnBlock(ADIOS_FILE *f, ADIOS_VARINFO *vi, int step, int rank, 
+	int size, int ndims, const size_t *start, const size_t *count)
+{
+	ADIOS_VARBLOCK *block;
+	int first = 0, per, i, j;
+
+	if (vi->nblocks == NULL || vi->nblocks[step] == 0 || 
+			vi->nblocks[step] % size != 0)
+		return -1;
+	if (adios_inq_var_blockinfo(f, vi) != 0 || vi->blockinfo == NULL)
+		return -1;
+
+	per = vi->nblocks[step] / size;
+	for (i = 0; i < step; ++i)
+		first += vi->nblocks[i];
+	for (j = rank * per; j < (rank + 1) * per; ++j) {
+		block = &vi->blockinfo[first + j];
+		for (i = 0; i < ndims; ++i)
+			if (block->start[i] != start[i] || block->count[i] != count[i])
+				break;
+		if (i == ndims)
+			return j;
+	}
+	return -1;
+}
+
+
+int
+nc2adios_read_vara(ADIOS_FILE *f, const char *name, int ndims,
+	const size_t *start, const size_t *count, void *data, MPI_Comm comm)
+{
+	ADIOS_VARINFO *vi;
+	ADIOS_SELECTION *sel;
+	uint64_t s[NC2ADIOS_MAX_DIMS], c[NC2ADIOS_MAX_DIMS];
+	int rank, size, step, own, i, err;
+
+	if (ndims > NC2ADIOS_MAX_DIMS || (vi = adios_inq_var(f, name)) == NULL)
+		return -1;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	step = vi->nsteps - 1;
+
+	own = FindOwnBlock(f, vi, step, rank, size, ndims, start, count);
+	if (own >= 0) {
+		sel = adios_selection_writeblock(own);
+	} else {
+		for (i = 0; i < ndims; ++i) {
+			s[i] = start[i];
+			c[i] = count[i];
+		}
+		sel = adios_selection_boundingbox(ndims, s, c);
+	}
+
+	err = adios_schedule_read(f, sel, name, step, 1, data);
+	if (err == 0)
+		err = adios_perform_reads(f, 1);
+
+	adios_selection_delete(sel);
+	adios_free_varinfo(vi);
+	return err;
+}
+
+
+/**************************************************
+ * In-situ analysis
+ **************************************************/
+static struct {
+	const char *name;
+	nc2adios_analysis_fn fn;
+	void *arg;
+} Callbacks[NC2ADIOS_MAX_CALLBACKS];
+static int CallbackNum = 0;
+
+
+int
+nc2adios_register_analysis(const char *name, nc2adios_analysis_fn fn,
+	void *arg)
+{
+	if (CallbackNum == NC2ADIOS_MAX_CALLBACKS)
+		return -1;
+	Callbacks[CallbackNum].name = name;
+	Callbacks[CallbackNum].fn = fn;
+	Callbacks[CallbackNum].arg = arg;
+	CallbackNum++;
+	return 0;
+}
+
+
+/***** Local min, max and sum, one pass, 
+		vectorizable loop per element type *****/
+#define NC2ADIOS_REDUCE(TYPE)											\
+static void																\
+Reduce_##TYPE(const TYPE *p, size_t n, double *mn, double *mx,			\
+	double *sum)														\
+{																		\
+	double lmn = DBL_MAX, lmx = -DBL_MAX, lsum = 0.0;					\
+	size_t i;															\
+	_Pragma("omp simd reduction(min:lmn) reduction(max:lmx) reduction(+:lsum)") \
+	for (i = 0; i < n; ++i) {											\
+		double v = (double)p[i];										\
+		lmn = v < lmn ? v : lmn;										\
+		lmx = v > lmx ? v : lmx;										\
+		lsum += v;														\
+	}																	\
+	*mn = lmn;															\
+	*mx = lmx;															\
+	*sum = lsum;														\
+}
+
+NC2ADIOS_REDUCE(int)
+NC2ADIOS_REDUCE(float)
+NC2ADIOS_REDUCE(double)
+
+
+/***** Write a reduction as <name>_<suffix> *****/
+static void
+WriteReduction(int64_t f, const char *name, const char *suffix, double val)
+{
+	char buf[256];
+
+	snprintf(buf, sizeof(buf), "%s_%s", name, suffix);
+	adios_write(f, buf, &val);
+}
+
+
+int
+nc2adios_analyze(int64_t f, const char *name, int type, const void *data,
+	int ndims, const size_t *start, const size_t *count, MPI_Comm comm,
+	int reductions)
+{
+	double loc[3], glob[3];		/* min, max, sum */
+	double n = 1.0, gn;
+	size_t len = 1;
+	int i, rank;
+
+	for (i = 0; i < CallbackNum; ++i)
+		if (Callbacks[i].name == NULL || strcmp(Callbacks[i].name, name) == 0)
+			Callbacks[i].fn(name, type, data, ndims, start, count, 
+				Callbacks[i].arg);
+
+	if (reductions == 0)
+		return 0;
+
+	for (i = 0; i < ndims; ++i)
+		len *= count[i];
+	n = (double)len;
+
+	switch (type) {
+	case NC2ADIOS_INT:
+		Reduce_int((const int*)data, len, &loc[0], &loc[1], &loc[2]);
+		break;
+	case NC2ADIOS_FLOAT:
+		Reduce_float((const float*)data, len, &loc[0], &loc[1], &loc[2]);
+		break;
+	case NC2ADIOS_DOUBLE:
+		Reduce_double((const double*)data, len, &loc[0], &loc[1], &loc[2]);
+		break;
+	default:
+		return -1;
+	}
+
+	/***** Max of -min gives min in the same call *****/
+	loc[0] = -loc[0];
+	MPI_Allreduce(loc, glob, 2, MPI_DOUBLE, MPI_MAX, comm);
+	MPI_Allreduce(&loc[2], &glob[2], 1, MPI_DOUBLE, MPI_SUM, comm);
+	MPI_Allreduce(&n, &gn, 1, MPI_DOUBLE, MPI_SUM, comm);
+	glob[0] = -glob[0];
+
+	MPI_Comm_rank(comm, &rank);
+	if (rank != 0)
+		return 0;
+	if (reductions & NC2ADIOS_MIN)
+		WriteReduction(f, name, "min", glob[0]);
+	if (reductions & NC2ADIOS_MAX)
+		WriteReduction(f, name, "max", glob[1]);
+	if (reductions & NC2ADIOS_SUM)
+		WriteReduction(f, name, "sum", glob[2]);
+	if (reductions & NC2ADIOS_MEAN)
+		WriteReduction(f, name, "mean", gn > 0 ? glob[2] / gn : 0.0);
+	return 0;
+}
+
+
+/**************************************************
+ * float to IEEE binary16, round to nearest even
+ **************************************************/
+static uint16_t
+FloatToHalf(float value)
+{
+	uint32_t x, mant, rem, half, r;
+	uint16_t sign;
+	int exp, shift;
+
+	memcpy(&x, &value, 4);
+	sign = (uint16_t)((x >> 16) & 0x8000);
+	exp = (int)((x >> 23) & 0xff) - 127 + 15;
+	mant = x & 0x7fffff;
+
+	if (((x >> 23) & 0xff) == 0xff)			/* inf, nan */
+		return sign | 0x7c00 | (mant ? 0x200 : 0);
+	if (exp >= 31)							/* overflow */
+		return sign | 0x7c00;
+	if (exp <= 0) {							/* subnormal, zero */
+		if (exp < -10)
+			return sign;
+		mant |= 0x800000;
+		shift = 14 - exp;
+	} else {
+		mant |= (uint32_t)exp << 23;
+		shift = 13;
+	}
+
+	/***** Round to nearest even, a carry out of the
+			mantissa bumps the exponent *****/
+	r = mant >> shift;
+	rem = mant & ((1u << shift) - 1);
+	half = 1u << (shift - 1);
+	if (rem > half || (rem == half && (r & 1)))
+		r++;
+	return sign | (uint16_t)r;
+}
+
+
+static uint16_t
+DoubleToHalf(double value)
+{
+	return FloatToHalf((float)value);
+}
+
+
+/***** Strided copy of one row, SRC elements to DST *****/
+#define NC2ADIOS_ROW(SRC, DST, CONV) do { \
+	const SRC *s = (const SRC *)src; \
+	DST *d = (DST *)dst; \
+	for (j = 0; j < n; ++j) \
+		d[j] = CONV(s[j * stride]); \
+} while (0)
+
+#define NC2ADIOS_CAST(v) (v)
+
+
+void *
+nc2adios_reduce(const void *data, int srcType, int dstType, int ndims,
+	const size_t *start, const size_t *count, int stride,
+	unsigned int *rstart, unsigned int *rcount)
+{
+	static char *buf = NULL;
+	static size_t bufSize = 0;
+	size_t first[NC2ADIOS_MAX_DIMS], idx[NC2ADIOS_MAX_DIMS];
+	size_t pitch[NC2ADIOS_MAX_DIMS];
+	size_t total = 1, srcUnit, dstUnit, n, j;
+	const char *src;
+	char *dst;
+	int i, last = ndims - 1;
+
+	assert(ndims > 0 && ndims <= NC2ADIOS_MAX_DIMS && stride > 0);
+	srcUnit = (srcType == NC2ADIOS_DOUBLE) ? 8 : 4;
+	dstUnit = (dstType == NC2ADIOS_SHORT || dstType == NC2ADIOS_HALF) ? 2 :
+		(dstType == NC2ADIOS_DOUBLE) ? 8 : 4;
+
+	/***** First kept index and the reduced block *****/
+	for (i = 0; i < ndims; ++i) {
+		first[i] = (stride - start[i] % stride) % stride;
+		rcount[i] = (count[i] > first[i]) ? 
+			(count[i] - first[i] + stride - 1) / stride : 0;
+		rstart[i] = (start[i] + stride - 1) / stride;
+		total *= rcount[i];
+		idx[i] = 0;
+	}
+	pitch[last] = srcUnit;
+	for (i = last; i > 0; --i)
+		pitch[i-1] = pitch[i] * count[i];
+
+	if (total * dstUnit > bufSize) {
+		free(buf);
+		bufSize = total * dstUnit;
+		buf = (char *)malloc(bufSize);
+		if (buf == NULL) {
+			fprintf(stderr, "nc2adios: can NOT allocate %lu bytes\n", 
+				(unsigned long)bufSize);
+			abort();
+		}
+	}
+	if (total == 0)
+		return buf;
+
+	/***** Odometer over the outer dims, one strided
+			row of the innermost dim per step *****/
+	n = rcount[last];
+	dst = buf;
+	for (;;) {
+		src = (const char *)data;
+		for (i = 0; i < ndims; ++i)
+			src += (first[i] + idx[i] * stride) * pitch[i];
+
+		if (srcType == NC2ADIOS_INT && dstType == NC2ADIOS_SHORT)
+			NC2ADIOS_ROW(int, short, (short));
+		else if (srcType == NC2ADIOS_FLOAT && dstType == NC2ADIOS_HALF)
+			NC2ADIOS_ROW(float, uint16_t, FloatToHalf);
+		else if (srcType == NC2ADIOS_DOUBLE && dstType == NC2ADIOS_FLOAT)
+			NC2ADIOS_ROW(double, float, (float));
+		else if (srcType == NC2ADIOS_DOUBLE && dstType == NC2ADIOS_HALF)
+			NC2ADIOS_ROW(double, uint16_t, DoubleToHalf);
+		else if (srcType == dstType && srcType == NC2ADIOS_INT)
+			NC2ADIOS_ROW(int, int, NC2ADIOS_CAST);
+		else if (srcType == dstType && srcType == NC2ADIOS_FLOAT)
+			NC2ADIOS_ROW(float, float, NC2ADIOS_CAST);
+		else if (srcType == dstType && srcType == NC2ADIOS_DOUBLE)
+			NC2ADIOS_ROW(double, double, NC2ADIOS_CAST);
+		else {
+			fprintf(stderr, "nc2adios: unsupported reduction %d to %d\n",
+				srcType, dstType);
+			abort();
+		}
+		dst += n * dstUnit;
+
+		for (i = last - 1; i >= 0; --i) {
+			if (++idx[i] < rcount[i])
+				break;
+			idx[i] = 0;
+		}
+		if (i < 0)
+			break;
+	}
+	return buf;
+}
+
+
+/**************************************************
+ * Copy the comma separated dims with a prefix
+ * on the last path part of each:
+ * "x,g/y" -> "cx,g/cy"
+ **************************************************/
+static void
+PrefixDims(char *out, size_t size, const char *dims, char prefix)
+{
+	size_t len = 0;
+	const char *p;
+
+	for (p = dims; *p != '\0' && len + 2 < size; ++p) {
+		if (p == dims || p[-1] == ',' || p[-1] == '/')
+			if (p[strcspn(p, ",/")] != '/')
+				out[len++] = prefix;
+		out[len++] = *p;
+	}
+	out[len] = '\0';
+}
+
+
+/**************************************************
+ * Name of one dim with a prefix on its last path
+ * part: "g/y" -> "g/cy"
+ **************************************************/
+static void
+PrefixName(char *out, size_t size, const char *dim, int len, char prefix)
+{
+	const char *base = dim + len;
+
+	while (base > dim && base[-1] != '/')
+		--base;
+	snprintf(out, size, "%.*s%c%.*s", (int)(base - dim), dim, prefix,
+		(int)(dim + len - base), base);
+}
+
+
+void
+nc2adios_define_vars(int64_t group, const nc2adios_var_desc *desc, int n,
+	int64_t *ids)
+{
+	char count[1024], offset[1024], name[256];
+	const char *p, *q;
+	int i, j, k, slot = 0;
+
+	for (i = 0; i < n; ++i) {
+		const nc2adios_var_desc *d = &desc[i];
+
+		if (d->kind == NC2ADIOS_DESC_DIM) {
+			ids[slot++] = adios_define_var(group, d->name, "", 
+				(enum ADIOS_DATATYPES)d->type, "", "", "");
+			continue;
+		}
+		if (d->kind == NC2ADIOS_DESC_REPLICATED) {
+			ids[slot++] = adios_define_var(group, d->name, "", 
+				(enum ADIOS_DATATYPES)d->type, d->dims, "", "");
+			continue;
+		}
+
+		/***** c<dim> and o<dim> once, every block
+				is written through these IDs *****/
+		for (k = 0; k < 2; ++k) {
+			j = (k == 0) ? slot : slot + d->ndims;
+			for (p = d->dims; *p != '\0'; p = (*q == ',') ? q+1 : q) {
+				q = strchr(p, ',');
+				if (q == NULL)
+					q = p + strlen(p);
+				PrefixName(name, sizeof(name), p, (int)(q - p),
+					(k == 0) ? 'c' : 'o');
+				ids[j++] = adios_define_var(group, name, "", 
+					adios_unsigned_integer, "", "", "");
+			}
+		}
+		slot += 2 * d->ndims;
+
+		PrefixDims(count, sizeof(count), d->dims, 'c');
+		PrefixDims(offset, sizeof(offset), d->dims, 'o');
+		ids[slot++] = adios_define_var(group, d->name, "", 
+			(enum ADIOS_DATATYPES)d->type, count, d->dims, offset);
+
+		for (p = d->reductions; *p != '\0'; p = (*q == ',') ? q+1 : q) {
+			q = strchr(p, ',');
+			if (q == NULL)
+				q = p + strlen(p);
+			snprintf(name, sizeof(name), "%s_%.*s", d->name, (int)(q - p), p);
+			adios_define_var(group, name, "", adios_double, "", "", "");
+		}
+	}
+}
+
+
+unsigned long long
+nc2adios_group_size(const nc2adios_var_desc *desc, int n,
+	const unsigned long long *ext, int rank)
+{
+	unsigned long long size = 0, elems, c;
+	const char *p;
+	int i, j, nred;
+
+	for (i = 0; i < n; ++i) {
+		const nc2adios_var_desc *d = &desc[i];
+
+		if (d->kind == NC2ADIOS_DESC_DIM)
+			continue;
+
+		elems = 1;
+		for (j = 0; j < d->ndims; ++j) {
+			c = *ext++;
+			if (d->kind == NC2ADIOS_DESC_GLOBAL && d->stride > 1)
+				c = (c + d->stride - 1) / d->stride;
+			elems *= c;
+		}
+
+		/***** Replicated: every rank writes the dims,
+				rank 0 the data *****/
+		if (d->kind == NC2ADIOS_DESC_REPLICATED) {
+			size += d->ndims * 8;
+			if (rank == 0)
+				size += elems * d->unitSize * d->iterNum;
+			continue;
+		}
+
+		/***** Global: dims, count and offset vars, data,
+				and the reductions on rank 0 *****/
+		size += d->ndims * 8 + 2 * d->ndims * 4 * d->iterNum +
+			elems * d->unitSize * d->iterNum;
+		nred = (*d->reductions != '\0');
+		for (p = d->reductions; *p != '\0'; ++p)
+			nred += (*p == ',');
+		if (rank == 0)
+			size += nred * 8 * d->iterNum;
+	}
+	return size;
+}
+
+
+char *
+nc2adios_piece(const char *fileName, int piece, int manifest, MPI_Comm comm)
+{
+	static char name[4096];
+	char list[4096];
+	size_t len = strlen(fileName);
+	int rank;
+	FILE *out;
+
+	if (len > 3 && strcmp(fileName + len - 3, ".bp") == 0)
+		len -= 3;
+	snprintf(name, sizeof(name), "%.*s.%d.bp", (int)len, fileName, piece);
+
+	MPI_Comm_rank(comm, &rank);
+	if (!manifest || rank != 0)
+		return name;
+
+	snprintf(list, sizeof(list), "%.*s.pieces", (int)len, fileName);
+	out = fopen(list, (piece == 0) ? "w" : "a");
+	if (out == NULL) {
+		fprintf(stderr, "nc2adios: can NOT write %s\n", list);
+		return name;
+	}
+	fprintf(out, "%s\n", name);
+	fclose(out);
+	return name;
+}
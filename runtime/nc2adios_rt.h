@@ -0,0 +1,344 @@
+#ifndef NC2ADIOS_RT_H
+#define NC2ADIOS_RT_H
+
+/**************************************************
+ * Runtime of translated programs
+ * Link with -lnc2adios_rt and the ADIOS read
+ * library.
+ **************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mpi.h>
+#include "adios.h"
+#include "adios_read.h"
+
+#define NC2ADIOS_MAX_DIMS 32
+
+
+/**************************************************
+ * ADIOS write API setup, once per process however
+ * many groups and translation units call it:
+ * adios_init(xml, comm), or adios_init_noxml(comm)
+ * and adios_allocate_buffer(buffer_mb) if xml is
+ * NULL. adios_finalize is run by MPI_Finalize,
+ * through a delete callback of an MPI_COMM_SELF
+ * attribute, before MPI shuts down.
+ * Return:
+ *		int: 0 on success
+ **************************************************/
+int
+nc2adios_init(const char *xml, MPI_Comm comm, unsigned long long buffer_mb);
+
+
+/**************************************************
+ * Read [start, start+count) of a var from the last
+ * step of a file, in place of nc_get_vara_*
+ * A restart on the rank count that wrote the file
+ * gets back the block this rank wrote that is the
+ * requested box (one of its IterNum blocks of the
+ * step) with a write-block selection; otherwise a
+ * bounding box selection is read.
+ * Return:
+ *		int: 0 on success
+ **************************************************/
+int
+nc2adios_read_vara(ADIOS_FILE *f, const char *name, int ndims,
+	const size_t *start, const size_t *count, void *data, MPI_Comm comm);
+
+
+
+/**************************************************
+ * In-situ analysis
+ * At each put of a var listed in the profile
+ * (analysis <var> [min] [max] [sum] [mean]) the
+ * translated code calls nc2adios_analyze right
+ * before adios_write. It hands the put buffer to
+ * the registered callbacks, then computes the
+ * reductions, reduces them over comm and rank 0
+ * writes each as the double var <var>_<reduction>.
+ **************************************************/
+
+/***** Element types *****/
+#define NC2ADIOS_INT	0
+#define NC2ADIOS_FLOAT	1
+#define NC2ADIOS_DOUBLE	2
+#define NC2ADIOS_SHORT	3
+#define NC2ADIOS_HALF	4	/* IEEE binary16 bits in an unsigned short */
+
+/***** Reductions *****/
+#define NC2ADIOS_MIN	1
+#define NC2ADIOS_MAX	2
+#define NC2ADIOS_SUM	4
+#define NC2ADIOS_MEAN	8
+
+#define NC2ADIOS_MAX_CALLBACKS 64
+
+
+/**************************************************
+ * Analysis callback: data points to the put
+ * buffer itself (no copy), the block is
+ * [start, start+count) of the global var
+ **************************************************/
+typedef void (*nc2adios_analysis_fn)(const char *name, int type,
+	const void *data, int ndims, const size_t *start, const size_t *count,
+	void *arg);
+
+
+/**************************************************
+ * Register a callback for the var name, or for
+ * every analysed var if name is NULL. name must
+ * stay valid while registered.
+ * Return:
+ *		int: 0 on success, -1 if the table is full
+ **************************************************/
+int
+nc2adios_register_analysis(const char *name, nc2adios_analysis_fn fn,
+	void *arg);
+
+
+/**************************************************
+ * Run the callbacks and reductions of one put
+ * Return:
+ *		int: 0 on success
+ **************************************************/
+int
+nc2adios_analyze(int64_t f, const char *name, int type, const void *data,
+	int ndims, const size_t *start, const size_t *count, MPI_Comm comm,
+	int reductions);
+
+
+/**************************************************
+ * Reduction stage of a put: keep the elements of
+ * [start, start+count) whose global index along
+ * every dim is a multiple of stride, converted
+ * from srcType to dstType, in a runtime owned
+ * staging buffer valid until the next call.
+ * Output:
+ *		unsigned int *rstart, *rcount: the block
+ *			in the decimated global var
+ * Return:
+ *		void *: the staging buffer
+ **************************************************/
+void *
+nc2adios_reduce(const void *data, int srcType, int dstType, int ndims,
+	const size_t *start, const size_t *count, int stride,
+	unsigned int *rstart, unsigned int *rcount);
+
+
+/**************************************************
+ * Var descriptor tables (-nc2adios:tables): one
+ * static const array per group, the dims first.
+ * The translated code defines the group's vars
+ * and computes its group size by looping over it
+ * instead of inlining a define per var and one
+ * size expression per group.
+ **************************************************/
+
+/***** Descriptor kinds *****/
+#define NC2ADIOS_DESC_DIM			0	/* scalar dim */
+#define NC2ADIOS_DESC_GLOBAL		1	/* blocks of a global array */
+#define NC2ADIOS_DESC_REPLICATED	2	/* local array, rank 0 writes */
+
+typedef struct {
+	const char *name;
+	int type;				/* enum ADIOS_DATATYPES, stored */
+	int kind;
+	int ndims;
+	const char *dims;		/* stored dims, comma separated */
+	int unitSize;
+	int iterNum;			/* blocks written per rank */
+	int stride;				/* decimation */
+	const char *reductions;	/* "min,max,..." each VAR_<red> double */
+} nc2adios_var_desc;
+
+
+/**************************************************
+ * adios_define_var of every descriptor: a global
+ * var gets its count vars c<dim>, offset vars
+ * o<dim>, the var and its reductions
+ * Output:
+ *		int64_t *ids: var IDs for adios_write_byid,
+ *			per dim one, per global var its c<dim>,
+ *			o<dim> and the var, per replicated var
+ *			one (reductions none)
+ **************************************************/
+void
+nc2adios_define_vars(int64_t group, const nc2adios_var_desc *desc, int n,
+	int64_t *ids);
+
+
+/**************************************************
+ * Group size of a table
+ * Input:
+ *		const unsigned long long *ext: for each
+ *			global var its block counts, for each
+ *			replicated var its dims, in table order
+ *		int rank: MPI rank
+ **************************************************/
+unsigned long long
+nc2adios_group_size(const nc2adios_var_desc *desc, int n,
+	const unsigned long long *ext, int rank);
+
+
+/**************************************************
+ * Output rollover: name of piece `piece` of the
+ * output fileName, out.bp -> out.<piece>.bp. With
+ * manifest set, rank 0 of comm lists the piece
+ * in out.pieces (truncated at piece 0).
+ * Return:
+ *		char *: static buffer, valid until the
+ *			next call
+ **************************************************/
+char *
+nc2adios_piece(const char *fileName, int piece, int manifest, MPI_Comm comm);
+
+
+/**************************************************
+ * I/O skeleton (-nc2adios:skeleton): replays the
+ * write pattern of the translated groups with
+ * synthetic data and no compute. The generated
+ * program holds one var table per group and
+ * calls nc2adios_skel_main. Global vars are
+ * split in blocks along their first dim.
+ **************************************************/
+
+typedef struct {
+	const char *name;
+	unsigned long long value;	/* 0: must be set with -d */
+	const char *base;			/* decimated: dim it is reduced from */
+	int stride;
+} nc2adios_skel_dim;
+
+typedef struct {
+	const char *name;
+	const char *fileName;
+	int stats;					/* adios statistics on */
+	const nc2adios_var_desc *vars;	/* dims first, as for define_vars */
+	int nvars;
+	nc2adios_skel_dim *dims;
+	int ndims;
+} nc2adios_skel_group;
+
+
+/**************************************************
+ * Run the skeleton, arguments:
+ *		-m METHOD		transport method, default MPI
+ *		-p PARAMS		method parameters
+ *		-b MB			buffer size, default 10
+ *		-i N			blocks per var, default as
+ *						translated
+ *		-d NAME=VALUE	size of a dim, repeatable
+ * Return:
+ *		int: exit status
+ **************************************************/
+int
+nc2adios_skel_main(int argc, char *argv[], 
+	const nc2adios_skel_group *groups, int n);
+
+
+/**************************************************
+ * Burst buffer staging (profile "stage DIR"):
+ * files are written with POSIX to the node-local
+ * DIR, and a background thread of each process
+ * copies them to their final name once closed.
+ * Copies go through a temporary file and rename,
+ * readers never see a partial file. The thread
+ * is joined at exit, after the last copy.
+ **************************************************/
+
+/**************************************************
+ * DIR/<base name of fileName>, in a static
+ * buffer; creates DIR
+ **************************************************/
+char *
+nc2adios_stage_path(const char *fileName, const char *dir);
+
+
+/**************************************************
+ * Queue the staged copy of a closed file: rank 0
+ * the file itself, each rank its POSIX subfile
+ * <file>.dir/<base>.<rank>
+ * Input:
+ *		int keep: copy only, the staged file is
+ *			opened again for append; call
+ *			nc2adios_stage_wait before that
+ **************************************************/
+void
+nc2adios_stage_drain(const char *fileName, const char *dir, int keep,
+	MPI_Comm comm);
+
+
+/**************************************************
+ * Block until the queued copies are done
+ **************************************************/
+void
+nc2adios_stage_wait(void);
+
+
+/**************************************************
+ * Puts inside OpenMP parallel regions: each
+ * thread packs its tiles into its own slot of a
+ * per-rank buffer, no lock, and after the region
+ * one thread assembles them into the block they
+ * cover and writes it as one put. The tiles of a
+ * rank must cover that block exactly.
+ *		static nc2adios_omp_buf adios_ompXX;
+ *		nc2adios_omp_begin(&adios_ompXX,
+ *			N of num_threads(N) or omp_get_max_threads(),
+ *			ndims, size);
+ *		#pragma omp parallel
+ *			nc2adios_omp_pack(&adios_ompXX,
+ *				omp_get_thread_num(), start, count, op);
+ *		data = nc2adios_omp_end(&adios_ompXX,
+ *			start, count);
+ **************************************************/
+
+typedef struct {
+	int ntiles, maxTiles;
+	size_t *start, *count;		/* ndims per tile */
+	char *data;					/* tiles, back to back */
+	size_t bytes, maxBytes;
+} nc2adios_omp_slot;
+
+typedef struct {
+	int nslots, ndims;
+	size_t size;				/* element size */
+	nc2adios_omp_slot *slots;	/* one per thread */
+	char *block;				/* assembled block */
+	size_t maxBytes;
+} nc2adios_omp_buf;
+
+
+/**************************************************
+ * Empty the slots before a region, buffers are
+ * kept from the previous one
+ **************************************************/
+void
+nc2adios_omp_begin(nc2adios_omp_buf *buf, int nthreads, int ndims,
+	size_t size);
+
+
+/**************************************************
+ * Copy one tile [start, start+count) into the
+ * slot of thread
+ **************************************************/
+void
+nc2adios_omp_pack(nc2adios_omp_buf *buf, int thread, const size_t *start,
+	const size_t *count, const void *data);
+
+
+/**************************************************
+ * Assemble the tiles of all threads
+ * Output:
+ *		size_t *start, *count: the block they
+ *			cover, all 0 if no tile
+ * Return:
+ *		void *: the block, valid until the next
+ *			call on buf
+ **************************************************/
+void *
+nc2adios_omp_end(nc2adios_omp_buf *buf, size_t *start, size_t *count);
+
+
+#endif
@@ -0,0 +1,350 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include "nc2adios_rt.h"
+
+
+/**************************************************
+ * Value of a dim of the group, -1 if unknown
+ **************************************************/
+static long long
+DimValue(const nc2adios_skel_group *grp, const char *name, size_t len)
+{
+	int i;
+
+	for (i = 0; i < grp->ndims; ++i)
+		if (strlen(grp->dims[i].name) == len &&
+				strncmp(grp->dims[i].name, name, len) == 0)
+			return (long long)grp->dims[i].value;
+	return -1;
+}
+
+
+/**************************************************
+ * Set the dims from -d NAME=VALUE, then the
+ * decimated ones from their base
+ * Return:
+ *		int: 0 if every dim has a size
+ **************************************************/
+static int
+SetDims(const nc2adios_skel_group *grp, char **defs, int ndefs, int rank)
+{
+	nc2adios_skel_dim *d;
+	const char *eq;
+	long long base;
+	int i, j, err = 0;
+
+	for (i = 0; i < grp->ndims; ++i) {
+		d = &grp->dims[i];
+		for (j = 0; j < ndefs; ++j) {
+			eq = strchr(defs[j], '=');
+			if (eq != NULL && strlen(d->name) == (size_t)(eq - defs[j]) &&
+					strncmp(d->name, defs[j], eq - defs[j]) == 0)
+				d->value = strtoull(eq + 1, NULL, 10);
+		}
+	}
+	for (i = 0; i < grp->ndims; ++i) {
+		d = &grp->dims[i];
+		if (d->base != NULL) {
+			base = DimValue(grp, d->base, strlen(d->base));
+			d->value = (base > 0) ? (base + d->stride - 1) / d->stride : 0;
+		}
+		if (d->value == 0) {
+			if (rank == 0 && d->base == NULL)
+				fprintf(stderr, "nc2adios skeleton: group %s: "
+					"no size for dim %s, use -d %s=VALUE\n", 
+					grp->name, d->name, d->name);
+			err = 1;
+		}
+	}
+	return err;
+}
+
+
+/**************************************************
+ * Dim sizes of a var, and this rank's block: the
+ * first dim split in blocks over the ranks
+ **************************************************/
+static void
+VarBlock(const nc2adios_skel_group *grp, const nc2adios_var_desc *v,
+	int rank, int size, unsigned long long *dims, unsigned int *off, 
+	unsigned int *cnt)
+{
+	const char *p, *q;
+	int i = 0;
+
+	for (p = v->dims; *p != '\0' && i < NC2ADIOS_MAX_DIMS; 
+			p = (*q == ',') ? q+1 : q) {
+		q = strchr(p, ',');
+		if (q == NULL)
+			q = p + strlen(p);
+		dims[i] = DimValue(grp, p, q - p);
+		off[i] = 0;
+		cnt[i] = dims[i];
+		i++;
+	}
+	if (v->kind == NC2ADIOS_DESC_GLOBAL && v->ndims > 0) {
+		off[0] = dims[0] * rank / size;
+		cnt[0] = dims[0] * (rank + 1) / size - off[0];
+	}
+}
+
+
+/**************************************************
+ * Blocks of var v in the k-th put, as the
+ * translated code writes them
+ **************************************************/
+static void
+WriteBlock(int64_t f, const nc2adios_skel_group *grp, 
+	const nc2adios_var_desc *v, const int64_t *ids, int k, int rank, 
+	int size, const char *buf)
+{
+	unsigned long long dims[NC2ADIOS_MAX_DIMS];
+	unsigned int off[NC2ADIOS_MAX_DIMS], cnt[NC2ADIOS_MAX_DIMS];
+	const char *p, *q;
+	char name[256];
+	double val = 0.0;
+	int j, next;
+
+	if (k >= v->iterNum)
+		return;
+	if (v->kind == NC2ADIOS_DESC_REPLICATED) {
+		if (rank == 0)
+			adios_write_byid(f, ids[0], (void *)buf);
+		return;
+	}
+
+	VarBlock(grp, v, rank, size, dims, off, cnt);
+	for (j = 0; j < v->ndims; ++j)
+		adios_write_byid(f, ids[j], &cnt[j]);
+	for (j = 0; j < v->ndims; ++j)
+		adios_write_byid(f, ids[v->ndims + j], &off[j]);
+	adios_write_byid(f, ids[2 * v->ndims], (void *)buf);
+	for (p = v->reductions; *p != '\0' && rank == 0; p = next ? q+1 : q) {
+		q = strchr(p, ',');
+		next = (q != NULL);
+		if (q == NULL)
+			q = p + strlen(p);
+		snprintf(name, sizeof(name), "%s_%.*s", v->name, (int)(q - p), p);
+		adios_write(f, name, &val);
+	}
+}
+
+
+/**************************************************
+ * Write the dim scalars of a group, after each
+ * adios_open
+ **************************************************/
+static void
+WriteDims(int64_t f, const nc2adios_skel_group *grp, const int64_t *ids,
+	const int *slots)
+{
+	unsigned long long dim;
+	int i;
+
+	for (i = 0; i < grp->nvars; ++i)
+		if (grp->vars[i].kind == NC2ADIOS_DESC_DIM) {
+			dim = DimValue(grp, grp->vars[i].name, strlen(grp->vars[i].name));
+			adios_write_byid(f, ids[slots[i]], &dim);
+		}
+}
+
+
+/**************************************************
+ * One group: define, open, write the dims and
+ * then each put of every var as the translated
+ * code does, close. With flush > 0 the file is
+ * closed and reopened for append every flush
+ * puts, as for "sync step".
+ * Output:
+ *		double *sec: time from open to close
+ * Return:
+ *		unsigned long long: group size of this rank
+ **************************************************/
+static unsigned long long
+RunGroup(const nc2adios_skel_group *grp, const char *method, 
+	const char *params, int flush, MPI_Comm comm, int rank, int size, 
+	double *sec)
+{
+	const nc2adios_var_desc *vars = grp->vars;
+	unsigned long long dims[NC2ADIOS_MAX_DIMS], *ext, gs, elems;
+	uint64_t ts;
+	unsigned int off[NC2ADIOS_MAX_DIMS], cnt[NC2ADIOS_MAX_DIMS];
+	int64_t group, f, *ids;
+	char *buf = NULL;
+	size_t bufSize = 0;
+	int i, j, k, *slots, nslot = 0, next_ext = 0, iters = 0;
+	double t0;
+
+	slots = (int *)malloc(grp->nvars * sizeof(int));
+	for (i = 0; i < grp->nvars; ++i) {
+		slots[i] = nslot;
+		nslot += (vars[i].kind == NC2ADIOS_DESC_GLOBAL) ? 
+			2 * vars[i].ndims + 1 : 1;
+		if (vars[i].kind != NC2ADIOS_DESC_DIM && vars[i].iterNum > iters)
+			iters = vars[i].iterNum;
+	}
+	ids = (int64_t *)malloc(nslot * sizeof(int64_t));
+	ext = (unsigned long long *)malloc(
+		(grp->nvars * NC2ADIOS_MAX_DIMS + 1) * sizeof(unsigned long long));
+
+	adios_declare_group(&group, grp->name, "", 
+		grp->stats ? adios_flag_yes : adios_flag_no);
+	adios_select_method(group, method, params, "");
+	nc2adios_define_vars(group, vars, grp->nvars, ids);
+
+	/***** Extents and buffer *****/
+	for (i = 0; i < grp->nvars; ++i) {
+		if (vars[i].kind == NC2ADIOS_DESC_DIM)
+			continue;
+		VarBlock(grp, &vars[i], rank, size, dims, off, cnt);
+		elems = 1;
+		for (j = 0; j < vars[i].ndims; ++j) {
+			ext[next_ext++] = (vars[i].kind == NC2ADIOS_DESC_GLOBAL) ?
+				cnt[j] : dims[j];
+			elems *= ext[next_ext - 1];
+		}
+		if (elems * vars[i].unitSize > bufSize)
+			bufSize = elems * vars[i].unitSize;
+	}
+	gs = nc2adios_group_size(vars, grp->nvars, ext, rank);
+	buf = (char *)malloc(bufSize > 0 ? bufSize : 1);
+	memset(buf, 0, bufSize);
+
+	MPI_Barrier(comm);
+	t0 = MPI_Wtime();
+	adios_open(&f, grp->name, grp->fileName, "w", comm);
+	adios_group_size(f, gs, &ts);
+	WriteDims(f, grp, ids, slots);
+
+	/***** A reopened step gets its dims again,
+			as the translated sync step does *****/
+	for (k = 0; k < iters; ++k) {
+		if (flush > 0 && k > 0 && k % flush == 0) {
+			adios_close(f);
+			adios_open(&f, grp->name, grp->fileName, "a", comm);
+			adios_group_size(f, gs, &ts);
+			WriteDims(f, grp, ids, slots);
+		}
+		for (i = 0; i < grp->nvars; ++i)
+			if (vars[i].kind != NC2ADIOS_DESC_DIM)
+				WriteBlock(f, grp, &vars[i], ids + slots[i], k, rank, size, 
+					buf);
+	}
+
+	adios_close(f);
+	MPI_Barrier(comm);
+	*sec = MPI_Wtime() - t0;
+
+	free(buf);
+	free(ext);
+	free(ids);
+	free(slots);
+	return gs;
+}
+
+
+static void
+Usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-m METHOD] [-p PARAMS] [-b MB] [-i N] "
+		"[-s on|off] [-f N] [-d NAME=VALUE]...\n", prog);
+}
+
+
+int
+nc2adios_skel_main(int argc, char *argv[], 
+	const nc2adios_skel_group *groups, int n)
+{
+	const char *method = "MPI", *params = "";
+	char **defs;
+	int ndefs = 0, mb = 10, iters = 0, stats = -1, flush = 0;
+	int rank, size, i, j, err = 0;
+	unsigned long long gs, total, allBytes = 0;
+	double sec, allSec = 0.0;
+	long rss, maxRss;
+	struct rusage usage;
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	defs = (char **)malloc(argc * sizeof(char *));
+	for (i = 1; i < argc; ++i) {
+		if (i + 1 < argc && strcmp(argv[i], "-m") == 0)
+			method = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "-p") == 0)
+			params = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "-b") == 0)
+			mb = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-i") == 0)
+			iters = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-s") == 0)
+			stats = (strcmp(argv[++i], "on") == 0);
+		else if (i + 1 < argc && strcmp(argv[i], "-f") == 0)
+			flush = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-d") == 0)
+			defs[ndefs++] = argv[++i];
+		else {
+			if (rank == 0)
+				Usage(argv[0]);
+			MPI_Finalize();
+			return 1;
+		}
+	}
+	for (i = 0; i < n; ++i)
+		err |= SetDims(&groups[i], defs, ndefs, rank);
+	if (err) {
+		MPI_Finalize();
+		return 1;
+	}
+
+	adios_init_noxml(comm);
+	adios_allocate_buffer(ADIOS_BUFFER_ALLOC_NOW, mb);
+
+	if (rank == 0)
+		printf("%d ranks, method %s \"%s\", buffer %d MB, flush %d\n", 
+			size, method, params, mb, flush);
+	for (i = 0; i < n; ++i) {
+		nc2adios_skel_group grp = groups[i];
+
+		/***** -i overrides the blocks per var *****/
+		nc2adios_var_desc *vars = (nc2adios_var_desc *)malloc(
+			groups[i].nvars * sizeof(nc2adios_var_desc));
+		memcpy(vars, groups[i].vars, 
+			groups[i].nvars * sizeof(nc2adios_var_desc));
+		for (j = 0; j < groups[i].nvars && iters > 0; ++j)
+			if (vars[j].kind != NC2ADIOS_DESC_DIM)
+				vars[j].iterNum = iters;
+		grp.vars = vars;
+		if (stats >= 0)
+			grp.stats = stats;
+
+		gs = RunGroup(&grp, method, params, flush, comm, rank, size, &sec);
+		MPI_Reduce(&gs, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, comm);
+		if (rank == 0)
+			printf("group %s -> %s: %llu bytes in %.3f s, %.1f MB/s\n",
+				grp.name, grp.fileName, total, sec,
+				total / 1048576.0 / (sec > 0 ? sec : 1e-9));
+		allBytes += total;
+		allSec += sec;
+		free(vars);
+	}
+
+	/***** Summary line, read by nc2adios-tune *****/
+	getrusage(RUSAGE_SELF, &usage);
+	rss = usage.ru_maxrss;
+	MPI_Reduce(&rss, &maxRss, 1, MPI_LONG, MPI_MAX, 0, comm);
+	if (rank == 0)
+		printf("total: %llu bytes in %.3f s, %.1f MB/s, peak %ld KB\n",
+			allBytes, allSec, 
+			allBytes / 1048576.0 / (allSec > 0 ? allSec : 1e-9), maxRss);
+
+	adios_finalize(rank);
+	MPI_Finalize();
+	free(defs);
+	return 0;
+}
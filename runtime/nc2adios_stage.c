@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "nc2adios_rt.h"
+
+
+typedef struct nc2adios_copy {
+	char *from;
+	char *to;
+	int keep;
+	struct nc2adios_copy *next;
+} nc2adios_copy;
+
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Cond = PTHREAD_COND_INITIALIZER;
+static nc2adios_copy *Head = NULL, *Tail = NULL;
+static int Busy = 0, Started = 0, Done = 0;
+static pthread_t Thread;
+
+
+static const char *
+BaseName(const char *path)
+{
+	const char *p = strrchr(path, '/');
+	return (p == NULL) ? path : p + 1;
+}
+
+
+/**************************************************
+ * Copy through <to>.tmp<pid> and rename
+ * Return:
+ *		int: 0 on success
+ **************************************************/
+static int
+CopyFile(const char *from, const char *to)
+{
+	char tmp[4096], buf[1 << 16];
+	FILE *in, *out;
+	size_t len;
+	int err = 0;
+
+	in = fopen(from, "rb");
+	if (in == NULL)
+		return -1;
+	snprintf(tmp, sizeof(tmp), "%s.tmp%d", to, (int)getpid());
+	out = fopen(tmp, "wb");
+	if (out == NULL) {
+		fclose(in);
+		return -1;
+	}
+	while ( (len = fread(buf, 1, sizeof(buf), in)) > 0 )
+		if (fwrite(buf, 1, len, out) != len) {
+			err = -1;
+			break;
+		}
+	fclose(in);
+	if (fclose(out) != 0 || err != 0 || rename(tmp, to) != 0) {
+		remove(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+
+static void *
+Drain(void *arg)
+{
+	nc2adios_copy *c;
+	char *slash;
+
+	(void)arg;
+	pthread_mutex_lock(&Lock);
+	for (;;) {
+		while (Head == NULL && !Done)
+			pthread_cond_wait(&Cond, &Lock);
+		if (Head == NULL)
+			break;
+		c = Head;
+		Head = c->next;
+		if (Head == NULL)
+			Tail = NULL;
+		Busy = 1;
+		pthread_mutex_unlock(&Lock);
+
+		if (CopyFile(c->from, c->to) != 0)
+			fprintf(stderr, "nc2adios: can NOT drain %s to %s\n", 
+				c->from, c->to);
+		else if (!c->keep) {
+			remove(c->from);
+
+			/***** Last subfile out removes <file>.dir *****/
+			slash = strrchr(c->from, '/');
+			if (slash != NULL && slash - c->from > 4 && 
+					strncmp(slash - 4, ".dir", 4) == 0) {
+				*slash = '\0';
+				rmdir(c->from);
+			}
+		}
+		free(c->from);
+		free(c->to);
+		free(c);
+
+		pthread_mutex_lock(&Lock);
+		Busy = 0;
+		pthread_cond_broadcast(&Cond);
+	}
+	pthread_mutex_unlock(&Lock);
+	return NULL;
+}
+
+
+static void
+Finish(void)
+{
+	pthread_mutex_lock(&Lock);
+	Done = 1;
+	pthread_cond_broadcast(&Cond);
+	pthread_mutex_unlock(&Lock);
+	pthread_join(Thread, NULL);
+}
+
+
+static void
+Queue(const char *from, const char *to, int keep)
+{
+	nc2adios_copy *c = (nc2adios_copy *)malloc(sizeof(nc2adios_copy));
+
+	c->from = strdup(from);
+	c->to = strdup(to);
+	c->keep = keep;
+	c->next = NULL;
+
+	pthread_mutex_lock(&Lock);
+	if (!Started) {
+		Started = 1;
+		pthread_create(&Thread, NULL, Drain, NULL);
+		atexit(Finish);
+	}
+	if (Tail == NULL)
+		Head = c;
+	else
+		Tail->next = c;
+	Tail = c;
+	pthread_cond_broadcast(&Cond);
+	pthread_mutex_unlock(&Lock);
+}
+
+
+char *
+nc2adios_stage_path(const char *fileName, const char *dir)
+{
+	static char name[4096];
+
+	mkdir(dir, 0755);
+	snprintf(name, sizeof(name), "%s/%s", dir, BaseName(fileName));
+	return name;
+}
+
+
+void
+nc2adios_stage_drain(const char *fileName, const char *dir, int keep,
+	MPI_Comm comm)
+{
+	char from[4096], to[4096];
+	const char *base = BaseName(fileName);
+	struct stat st;
+	int rank;
+
+	MPI_Comm_rank(comm, &rank);
+	snprintf(from, sizeof(from), "%s/%s", dir, base);
+	if (rank == 0 && stat(from, &st) == 0)
+		Queue(from, fileName, keep);
+
+	snprintf(from, sizeof(from), "%s/%s.dir/%s.%d", dir, base, base, rank);
+	if (stat(from, &st) == 0) {
+		snprintf(to, sizeof(to), "%s.dir", fileName);
+		mkdir(to, 0755);
+		snprintf(to, sizeof(to), "%s.dir/%s.%d", fileName, base, rank);
+		Queue(from, to, keep);
+	}
+}
+
+
+void
+nc2adios_stage_wait(void)
+{
+	pthread_mutex_lock(&Lock);
+	while (Head != NULL || Busy)
+		pthread_cond_wait(&Cond, &Lock);
+	pthread_mutex_unlock(&Lock);
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "astfile.h"
+#include "cache.h"
+
+using namespace std;
+
+
+/****************************************
+ * AST file of a command line, named by
+ * the hash of the working directory and
+ * the arguments
+ ****************************************/
+static string
+GetAstPath(const vector<string> &argvList, const Options &opts)
+{
+	char buf[4096];
+	unsigned long long hash;
+
+	hash = HashStr(getcwd(buf, sizeof(buf)) != NULL ? buf : "");
+	for (vector<string>::size_type i = 1; i < argvList.size(); ++i)
+		hash = HashStr(string("\0", 1) + argvList[i], hash);
+
+	return opts.AstDir + "/" + HashHex(hash) + ".ast";
+}
+
+
+/****************************************
+ * Read the saved AST of a command line
+ ****************************************/
+SgProject *
+LoadAst(const vector<string> &argvList, const string &stamp,
+		const Options &opts)
+{
+	string path = GetAstPath(argvList, opts);
+	ifstream in((path + ".stamp").c_str());
+	string oldStamp;
+
+	if (stamp.empty() || !(in >> oldStamp) || oldStamp != stamp)
+		return NULL;
+
+	cout << "Loading saved AST: " << path << endl;
+	AST_FILE_IO::clearAllMemoryPools();
+	return AST_FILE_IO::readASTFromFile(path);
+}
+
+
+/****************************************
+ * Save the AST of a command line
+ ****************************************/
+void
+SaveAst(SgProject *project, const vector<string> &argvList,
+		const string &stamp, const Options &opts)
+{
+	string path = GetAstPath(argvList, opts);
+	string stampPath = path + ".stamp";
+
+	if (stamp.empty()) {
+		cout << "WARNING: can NOT stamp the input, AST not saved" << endl;
+		return;
+	}
+
+	mkdir(opts.AstDir.c_str(), 0755);
+
+	/***** The stamp goes last, it marks 
+			the AST file complete *****/
+	remove(stampPath.c_str());
+	AST_FILE_IO::startUp(project);
+	AST_FILE_IO::writeASTToFile(path);
+	AST_FILE_IO::resetValidAstAfterWriting();
+
+	ofstream out(stampPath.c_str());
+	out << stamp << endl;
+	if (!out) {
+		cout << "WARNING: can NOT write " << stampPath << endl;
+		return;
+	}
+	cout << "Saved AST: " << path << endl;
+}
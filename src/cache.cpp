@@ -0,0 +1,325 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+using namespace std;
+
+
+/****************************************
+ * 64 bit FNV-1a hash
+ ****************************************/
+unsigned long long
+HashStr(const string &str, unsigned long long hash)
+{
+	for (string::size_type i = 0; i < str.length(); ++i) {
+		hash ^= (unsigned char)str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+static bool
+IsSrcFile(const string &arg)
+{
+	string::size_type pos = arg.rfind('.');
+	if (arg.empty() || arg[0] == '-' || pos == string::npos)
+		return false;
+
+	string ext = arg.substr(pos);
+	return ext == ".c" || ext == ".C" || ext == ".cc" ||
+		ext == ".cpp" || ext == ".cxx";
+}
+
+
+/****************************************
+ * Source files on a frontend command line
+ ****************************************/
+vector<string>
+GetSrcFiles(const vector<string> &argvList)
+{
+	vector<string> vec;
+
+	for (vector<string>::size_type i = 1; i < argvList.size(); ++i) {
+		if (argvList[i] == "-o" || argvList[i] == "-rose:output") {
+			i++;
+			continue;
+		}
+		if (IsSrcFile(argvList[i]))
+			vec.push_back(argvList[i]);
+	}
+	return vec;
+}
+
+
+/****************************************
+ * File name ROSE unparses a source to:
+ * rose_<basename> in the current directory
+ ****************************************/
+string
+GetUnparseFileName(const string &src)
+{
+	string::size_type pos = src.rfind('/');
+	if (pos == string::npos)
+		return "rose_" + src;
+	return "rose_" + src.substr(pos+1);
+}
+
+
+static string
+ShellQuote(const string &arg)
+{
+	string str = "'";
+	for (string::size_type i = 0; i < arg.length(); ++i) {
+		if (arg[i] == '\'')
+			str += "'\\''";
+		else
+			str += arg[i];
+	}
+	return str + "'";
+}
+
+
+/****************************************
+ * Run the C preprocessor on the frontend
+ * command line. NC2ADIOS_CPP overrides
+ * the compiler used, default "cc".
+ ****************************************/
+bool
+Preprocess(const vector<string> &argvList, string &text)
+{
+	const char *cpp = getenv("NC2ADIOS_CPP");
+	string cmd = (cpp != NULL) ? cpp : "cc";
+
+	cmd += " -E";
+	for (vector<string>::size_type i = 1; i < argvList.size(); ++i) {
+		const string &arg = argvList[i];
+		if (arg == "-o" || arg == "-rose:output") {
+			i++;
+			continue;
+		}
+		if (arg == "-c" || arg.compare(0, 6, "-rose:") == 0)
+			continue;
+		cmd += " " + ShellQuote(arg);
+	}
+	cmd += " 2>/dev/null";
+
+	FILE *pipe = popen(cmd.c_str(), "r");
+	if (pipe == NULL)
+		return false;
+
+	char buf[65536];
+	size_t len;
+	text.clear();
+	while ( (len = fread(buf, 1, sizeof(buf), pipe)) > 0 )
+		text.append(buf, len);
+
+	return pclose(pipe) == 0;
+}
+
+
+/****************************************
+ * Translator version and build: the
+ * version string plus size and mtime of
+ * the executable
+ ****************************************/
+static string
+GetTranslatorStamp()
+{
+	struct stat st;
+	ostringstream stamp;
+
+	stamp << NC2ADIOS_VERSION;
+	if (stat("/proc/self/exe", &st) == 0)
+		stamp << ' ' << st.st_size << ' ' << st.st_mtime;
+	return stamp.str();
+}
+
+
+/****************************************
+ * Hash as 16 hex digits
+ ****************************************/
+string
+HashHex(unsigned long long hash)
+{
+	char str[32];
+	snprintf(str, 32, "%016llx", hash);
+	return string(str);
+}
+
+
+/****************************************
+ * Cache key of a command line
+ ****************************************/
+string
+GetCacheKey(const vector<string> &argvList, const Options &opts)
+{
+	string text;
+	unsigned long long hash;
+
+	if (GetSrcFiles(argvList).size() != 1)
+		return string();
+	if (!Preprocess(argvList, text))
+		return string();
+
+	hash = HashStr(text);
+	hash = HashStr(GetTranslatorStamp(), hash);
+	hash = HashStr(opts.Prof.GetText(), hash);
+	for (vector<string>::size_type i = 0; i < opts.KeyOpts.size(); ++i)
+		hash = HashStr(opts.KeyOpts[i] + '\0', hash);
+
+	return HashHex(hash);
+}
+
+
+/****************************************
+ * Stamp of the frontend input: the
+ * preprocessed input, the translator
+ * and the frontend command line
+ ****************************************/
+string
+GetInputStamp(const vector<string> &argvList)
+{
+	string text;
+	unsigned long long hash;
+
+	if (!Preprocess(argvList, text))
+		return string();
+
+	hash = HashStr(text);
+	hash = HashStr(GetTranslatorStamp(), hash);
+	for (vector<string>::size_type i = 1; i < argvList.size(); ++i)
+		hash = HashStr(argvList[i] + '\0', hash);
+
+	return HashHex(hash);
+}
+
+
+/****************************************
+ * Copy a file, through a temporary file
+ * and rename so that concurrent readers
+ * never see a partial file
+ ****************************************/
+static bool
+CopyFile(const string &from, const string &to)
+{
+	ifstream in(from.c_str(), ios::binary);
+	if (!in)
+		return false;
+
+	char suffix[32];
+	snprintf(suffix, 32, ".tmp%d", (int)getpid());
+	string tmp = to + suffix;
+
+	ofstream out(tmp.c_str(), ios::binary);
+	if (!out)
+		return false;
+	out << in.rdbuf();
+	out.close();
+
+	if (!out || rename(tmp.c_str(), to.c_str()) != 0) {
+		remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+/****************************************
+ * Files of a cache entry: suffix in the
+ * cache and the output path they go to.
+ * The first one is the unparsed output,
+ * or, if nothing was unparsed, an empty
+ * ".none" entry standing for the missing
+ * rose_* file.
+ ****************************************/
+static vector< pair<string, string> >
+GetEntryFiles(const string &src, const Options &opts, bool unparsed)
+{
+	vector< pair<string, string> > vec;
+
+	vec.push_back(make_pair(string(unparsed ? ".out" : ".none"),
+		GetUnparseFileName(src)));
+	if (!opts.Manifest.empty())
+		vec.push_back(make_pair(string(".groups"), opts.Manifest));
+	if (!opts.XmlFile.empty())
+		vec.push_back(make_pair(string(".xml"), opts.XmlFile));
+	if (!opts.SkeletonFile.empty())
+		vec.push_back(make_pair(string(".skel"), opts.SkeletonFile));
+	return vec;
+}
+
+
+/****************************************
+ * Copy a cached output to its unparse
+ * file name (and manifest, XML config).
+ * A ".none" entry removes a stale rose_*
+ * file instead.
+ ****************************************/
+bool
+CacheFetch(const string &key, const string &src, const Options &opts,
+			bool &unparsed)
+{
+	string entry = opts.CacheDir + "/" + key;
+	struct stat st;
+
+	unparsed = stat((entry + ".out").c_str(), &st) == 0;
+	vector< pair<string, string> > files = GetEntryFiles(src, opts, unparsed);
+	for (vector< pair<string, string> >::size_type i = 0;
+			i < files.size(); ++i)
+		if (stat((entry + files[i].first).c_str(), &st) != 0)
+			return false;
+
+	if (!unparsed)
+		remove(files[0].second.c_str());
+	for (vector< pair<string, string> >::size_type i = unparsed ? 0 : 1;
+			i < files.size(); ++i)
+		if (!CopyFile(entry + files[i].first, files[i].second))
+			return false;
+
+	cout << "Translation cache hit: " << key << endl;
+	return true;
+}
+
+
+/****************************************
+ * Store the unparsed output (and manifest,
+ * XML config), or a ".none" entry if
+ * nothing was unparsed
+ ****************************************/
+void
+CacheStore(const string &key, const string &src, const Options &opts,
+			bool unparsed)
+{
+	string entry = opts.CacheDir + "/" + key;
+	vector< pair<string, string> > files = GetEntryFiles(src, opts, unparsed);
+
+	mkdir(opts.CacheDir.c_str(), 0755);
+
+	/***** The unparsed output (or ".none") goes last,
+			it marks the entry complete for CacheFetch *****/
+	for (vector< pair<string, string> >::size_type i = files.size();
+			i-- > 1; )
+		if (!CopyFile(files[i].second, entry + files[i].first)) {
+			cout << "WARNING: can NOT store translation cache entry "
+				<< key << endl;
+			return;
+		}
+
+	bool stored;
+	if (unparsed) {
+		stored = CopyFile(files[0].second, entry + files[0].first);
+	} else {
+		ofstream out((entry + files[0].first).c_str());
+		out.close();
+		stored = !out.fail();
+	}
+	if (!stored)
+		cout << "WARNING: can NOT store translation cache entry "
+			<< key << endl;
+}
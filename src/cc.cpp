@@ -0,0 +1,241 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "cache.h"
+
+using namespace std;
+
+
+/**************************************************
+ * nc2adios-cc: compiler wrapper, used in place of
+ * mpicc. Every source file on the command line
+ * that calls nc_* functions is translated first
+ * and its rose_* output compiled instead; other
+ * files, and files the translator left alone,
+ * go to the compiler untouched.
+ *		$NC2ADIOS_CC		real compiler, default mpicc
+ *		$NC2ADIOS			translator, default NC2ADIOS
+ *		$NC2ADIOS_SERVER	translate through the server
+ *							with nc2adios-client
+ *		$NC2ADIOS_FLAGS		extra translator options
+ * -nc2adios:* options on the command line go to
+ * the translator only.
+ **************************************************/
+
+
+static string
+GetEnv(const char *name, const char *def)
+{
+	const char *val = getenv(name);
+	return (val != NULL && *val != '\0') ? val : def;
+}
+
+
+/****************************************
+ * Cheap pre-scan: does the file call any
+ * nc_* function? Comments and strings
+ * are not told apart, a false positive
+ * only costs a translation.
+ ****************************************/
+static bool
+CallsNetCDF(const string &path)
+{
+	ifstream in(path.c_str());
+	stringstream text;
+	text << in.rdbuf();
+	const string &str = text.str();
+
+	for (string::size_type pos = str.find("nc_"); pos != string::npos;
+			pos = str.find("nc_", pos+3)) {
+		if (pos > 0 && (isalnum(str[pos-1]) || str[pos-1] == '_'))
+			continue;
+		string::size_type end = pos + 3;
+		while (end < str.length() && (isalnum(str[end]) || str[end] == '_'))
+			end++;
+		while (end < str.length() && isspace(str[end]))
+			end++;
+		if (end > pos + 3 && end < str.length() && str[end] == '(')
+			return true;
+	}
+	return false;
+}
+
+
+/****************************************
+ * Run a command, wait for it
+ * Return:
+ *		int: exit status
+ ****************************************/
+static int
+Run(const vector<string> &args)
+{
+	vector<char*> argv;
+	for (vector<string>::size_type i = 0; i < args.size(); ++i)
+		argv.push_back(const_cast<char*>(args[i].c_str()));
+	argv.push_back(NULL);
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		execvp(argv[0], &argv[0]);
+		perror(argv[0]);
+		_exit(127);
+	}
+	int status;
+	if (pid < 0 || waitpid(pid, &status, 0) < 0)
+		return 127;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 128;
+}
+
+
+static string
+DirName(const string &path)
+{
+	string::size_type pos = path.rfind('/');
+	if (pos == string::npos)
+		return ".";
+	return pos == 0 ? "/" : path.substr(0, pos);
+}
+
+
+static string
+ObjName(const string &src)
+{
+	string base = src.substr(src.rfind('/') + 1);
+	return base.substr(0, base.rfind('.')) + ".o";
+}
+
+
+/****************************************
+ * Preprocessor options of a compile
+ * command, for the frontend
+ ****************************************/
+static vector<string>
+GetCppArgs(const vector<string> &args)
+{
+	vector<string> vec;
+
+	for (vector<string>::size_type i = 0; i < args.size(); ++i) {
+		const string &arg = args[i];
+		if ( (arg == "-I" || arg == "-D" || arg == "-U" || arg == "-isystem" ||
+				arg == "-include") && i+1 < args.size() ) {
+			vec.push_back(arg);
+			vec.push_back(args[++i]);
+		} else if (arg.compare(0, 2, "-I") == 0 || 
+				arg.compare(0, 2, "-D") == 0 || arg.compare(0, 2, "-U") == 0 ||
+				arg.compare(0, 5, "-std=") == 0) {
+			vec.push_back(arg);
+		}
+	}
+	return vec;
+}
+
+
+/****************************************
+ * Translate one source file
+ ****************************************/
+static int
+Translate(const string &src, const vector<string> &cppArgs,
+		const vector<string> &ncOpts)
+{
+	vector<string> args;
+
+	/***** The client takes the socket from
+			$NC2ADIOS_SERVER itself, then all its
+			arguments go to the job *****/
+	if (!GetEnv("NC2ADIOS_SERVER", "").empty())
+		args.push_back("nc2adios-client");
+	else
+		args.push_back(GetEnv("NC2ADIOS", "NC2ADIOS"));
+
+	istringstream flags(GetEnv("NC2ADIOS_FLAGS", ""));
+	string flag;
+	while (flags >> flag)
+		args.push_back(flag);
+	args.insert(args.end(), ncOpts.begin(), ncOpts.end());
+	args.insert(args.end(), cppArgs.begin(), cppArgs.end());
+	args.push_back("-rose:skipfinalCompileStep");
+	args.push_back("-c");
+	args.push_back(src);
+
+	return Run(args);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	vector<string> args, ncOpts, ccArgs;
+	bool compileOnly = false, hasOutput = false;
+
+	/***** Split off the translator options *****/
+	args.push_back(argv[0]);
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg.compare(0, 10, "-nc2adios:") == 0) {
+			ncOpts.push_back(arg);
+			if (!IsFlagOption(arg) && i+1 < argc)
+				ncOpts.push_back(argv[++i]);
+			continue;
+		}
+		if (arg == "-c")
+			compileOnly = true;
+		if (arg == "-o")
+			hasOutput = true;
+		args.push_back(arg);
+	}
+
+	vector<string> srcVec = GetSrcFiles(args);
+	vector<string> cppArgs = GetCppArgs(args);
+
+	/***** Translate NetCDF sources, compile 
+			their output in their place *****/
+	ccArgs.push_back(GetEnv("NC2ADIOS_CC", "mpicc"));
+	for (vector<string>::size_type i = 1; i < args.size(); ++i) {
+		const string &arg = args[i];
+		if (arg == "-o" && i+1 < args.size()) {
+			ccArgs.push_back(arg);
+			ccArgs.push_back(args[++i]);
+			continue;
+		}
+		if (find(srcVec.begin(), srcVec.end(), arg) == srcVec.end() ||
+				!CallsNetCDF(arg)) {
+			ccArgs.push_back(arg);
+			continue;
+		}
+
+		int status = Translate(arg, cppArgs, ncOpts);
+		if (status != 0) {
+			cerr << "nc2adios-cc: translating " << arg << " failed" << endl;
+			return status;
+		}
+
+		/***** No group found: the file is not
+				unparsed, compile the original *****/
+		if (access(GetUnparseFileName(arg).c_str(), R_OK) != 0) {
+			ccArgs.push_back(arg);
+			continue;
+		}
+
+		/***** Quoted includes are relative to
+				the original source *****/
+		ccArgs.push_back("-I" + DirName(arg));
+		ccArgs.push_back(GetUnparseFileName(arg));
+
+		/***** Keep the object name of the original *****/
+		if (compileOnly && !hasOutput && srcVec.size() == 1) {
+			ccArgs.push_back("-o");
+			ccArgs.push_back(ObjName(arg));
+		}
+	}
+
+	return Run(ccArgs);
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+
+using namespace std;
+
+
+/**************************************************
+ * nc2adios-client: submit one translation job to
+ * a translation server and print its output
+ * Usage:
+ *		nc2adios-client SOCKET [NC2ADIOS arguments]
+ * SOCKET may also be given in $NC2ADIOS_SERVER,
+ * then all arguments go to the job.
+ * Exit status is the status of the job.
+ **************************************************/
+int
+main(int argc, char *argv[])
+{
+	const char *env = getenv("NC2ADIOS_SERVER");
+	int first = 1;
+	string path;
+
+	if (env != NULL) {
+		path = env;
+	} else if (argc > 1) {
+		path = argv[1];
+		first = 2;
+	} else {
+		cerr << "Usage: " << argv[0] << " SOCKET [arguments]" << endl;
+		return 2;
+	}
+
+	/***** Request: cwd, then argv *****/
+	char buf[4096];
+	if (getcwd(buf, sizeof(buf)) == NULL) {
+		perror("getcwd");
+		return 2;
+	}
+	string request = string(buf) + '\0' + "NC2ADIOS" + '\0';
+	for (int i = first; i < argc; ++i)
+		request += string(argv[i]) + '\0';
+
+	struct sockaddr_un addr;
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+	if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		perror(path.c_str());
+		return 2;
+	}
+
+	for (string::size_type done = 0; done < request.length(); ) {
+		ssize_t len = write(sock, request.data()+done, request.length()-done);
+		if (len <= 0) {
+			perror("write");
+			return 2;
+		}
+		done += len;
+	}
+	shutdown(sock, SHUT_WR);
+
+	/***** Output, the exit tag line is the last *****/
+	string output;
+	ssize_t len;
+	while ( (len = read(sock, buf, sizeof(buf))) > 0 )
+		output.append(buf, len);
+	close(sock);
+
+	string tag = string("\n") + NC2ADIOS_EXIT_TAG;
+	string::size_type pos = output.rfind(tag);
+	if (pos == string::npos) {
+		cout << output;
+		cerr << "ERROR: translation server closed the connection" << endl;
+		return 2;
+	}
+	cout << output.substr(0, pos);
+	cout.flush();
+	return atoi(output.c_str() + pos + tag.length());
+}
@@ -0,0 +1,563 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "driver.h"
+
+using namespace std;
+
+
+/****************************************
+ * Absolute path of the running executable
+ ****************************************/
+static string
+SelfPath()
+{
+	char buf[4096];
+	ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf)-1);
+
+	if (len <= 0) {
+		cout << "ERROR: can NOT locate own executable. Quit." << endl;
+		exit(1);
+	}
+	buf[len] = '\0';
+	return string(buf);
+}
+
+
+static string
+CurrentDir()
+{
+	char buf[4096];
+
+	if (getcwd(buf, sizeof(buf)) == NULL) {
+		cout << "ERROR: getcwd failed. Quit." << endl;
+		exit(1);
+	}
+	return string(buf);
+}
+
+
+/****************************************
+ * Split a shell command line into words,
+ * honouring quotes and backslashes
+ ****************************************/
+static vector<string>
+SplitCommand(const string &cmd)
+{
+	vector<string> words;
+	string word;
+	bool inWord = false;
+	char quote = 0;
+
+	for (string::size_type i = 0; i < cmd.length(); ++i) {
+		char c = cmd[i];
+
+		if (quote != 0) {
+			if (c == quote)
+				quote = 0;
+			else if (c == '\\' && quote == '"' && i+1 < cmd.length())
+				word += cmd[++i];
+			else
+				word += c;
+		} else if (c == '\'' || c == '"') {
+			quote = c;
+			inWord = true;
+		} else if (c == '\\' && i+1 < cmd.length()) {
+			word += cmd[++i];
+			inWord = true;
+		} else if (isspace(c)) {
+			if (inWord)
+				words.push_back(word);
+			word.clear();
+			inWord = false;
+		} else {
+			word += c;
+			inWord = true;
+		}
+	}
+	if (inWord)
+		words.push_back(word);
+
+	return words;
+}
+
+
+/**************************************************
+ * Minimal JSON reader, just enough for
+ * compile_commands.json: an array of objects
+ * whose values are strings or arrays of strings
+ **************************************************/
+class JsonReader
+{
+public:
+	JsonReader(const string &text): Text(text), Pos(0) {}
+
+	bool
+	ReadEntries(vector< map<string, vector<string> > > &entries);
+
+private:
+	const string &Text;
+	string::size_type Pos;
+
+	void SkipSpace();
+	bool Expect(char c);
+	bool ReadString(string &str);
+	bool ReadValue(vector<string> &vals);
+	bool SkipScalar();
+};
+
+
+void
+JsonReader::SkipSpace()
+{
+	while (Pos < Text.length() && isspace(Text[Pos]))
+		Pos++;
+}
+
+
+bool
+JsonReader::Expect(char c)
+{
+	SkipSpace();
+	if (Pos < Text.length() && Text[Pos] == c) {
+		Pos++;
+		return true;
+	}
+	return false;
+}
+
+
+bool
+JsonReader::ReadString(string &str)
+{
+	if (!Expect('"'))
+		return false;
+
+	str.clear();
+	while (Pos < Text.length() && Text[Pos] != '"') {
+		char c = Text[Pos++];
+		if (c == '\\' && Pos < Text.length()) {
+			c = Text[Pos++];
+			if (c == 'n')
+				c = '\n';
+			else if (c == 't')
+				c = '\t';
+			else if (c == 'u') {
+				/***** Only ASCII is expected in paths *****/
+				c = (char)strtol(Text.substr(Pos, 4).c_str(), NULL, 16);
+				Pos += 4;
+			}
+		}
+		str += c;
+	}
+	return Expect('"');
+}
+
+
+bool
+JsonReader::SkipScalar()
+{
+	SkipSpace();
+	string::size_type start = Pos;
+	while (Pos < Text.length() && Text[Pos] != ',' &&
+			Text[Pos] != '}' && Text[Pos] != ']' && !isspace(Text[Pos]))
+		Pos++;
+	return Pos > start;
+}
+
+
+/****************************************
+ * A string, an array of strings or a
+ * scalar, which is skipped
+ ****************************************/
+bool
+JsonReader::ReadValue(vector<string> &vals)
+{
+	string str;
+
+	vals.clear();
+	SkipSpace();
+	if (Pos >= Text.length())
+		return false;
+
+	if (Text[Pos] == '"') {
+		if (!ReadString(str))
+			return false;
+		vals.push_back(str);
+		return true;
+	}
+
+	if (Text[Pos] == '[') {
+		Pos++;
+		if (Expect(']'))
+			return true;
+		do {
+			if (!ReadString(str))
+				return false;
+			vals.push_back(str);
+		} while (Expect(','));
+		return Expect(']');
+	}
+
+	return SkipScalar();
+}
+
+
+bool
+JsonReader::ReadEntries(vector< map<string, vector<string> > > &entries)
+{
+	string key;
+	vector<string> vals;
+
+	if (!Expect('['))
+		return false;
+	if (Expect(']'))
+		return true;
+
+	do {
+		map<string, vector<string> > entry;
+		if (!Expect('{'))
+			return false;
+		if (!Expect('}')) {
+			do {
+				if (!ReadString(key) || !Expect(':') || !ReadValue(vals))
+					return false;
+				entry[key] = vals;
+			} while (Expect(','));
+			if (!Expect('}'))
+				return false;
+		}
+		entries.push_back(entry);
+	} while (Expect(','));
+
+	return Expect(']');
+}
+
+
+/**************************************************
+ * Read a file list, one source file per line
+ **************************************************/
+void
+ReadFileList(const string &path, const vector<string> &commonArgs,
+			vector<Job> &jobs)
+{
+	ifstream in(path.c_str());
+	string line;
+
+	if (!in) {
+		cout << "ERROR: can NOT open file list " << path << endl;
+		exit(1);
+	}
+
+	while (getline(in, line)) {
+		vector<string> words = SplitCommand(line.substr(0, line.find('#')));
+		if (words.empty())
+			continue;
+
+		Job job;
+		job.Src = words[0];
+		job.Args = commonArgs;
+		job.Args.push_back(job.Src);
+		jobs.push_back(job);
+	}
+}
+
+
+/**************************************************
+ * Read a compile_commands.json compilation database
+ **************************************************/
+void
+ReadCompDB(const string &path, const vector<string> &commonArgs,
+			vector<Job> &jobs)
+{
+	ifstream in(path.c_str());
+	stringstream text;
+	vector< map<string, vector<string> > > entries;
+
+	if (!in) {
+		cout << "ERROR: can NOT open compilation database " << path << endl;
+		exit(1);
+	}
+	text << in.rdbuf();
+
+	string str = text.str();
+	JsonReader reader(str);
+	if (!reader.ReadEntries(entries)) {
+		cout << "ERROR: malformed compilation database " << path << endl;
+		exit(1);
+	}
+
+	for (vector< map<string, vector<string> > >::size_type i = 0;
+			i < entries.size(); ++i) {
+		map<string, vector<string> > &entry = entries[i];
+		vector<string> words;
+
+		if (!entry["arguments"].empty())
+			words = entry["arguments"];
+		else if (!entry["command"].empty())
+			words = SplitCommand(entry["command"][0]);
+
+		if (words.empty() || entry["file"].empty()) {
+			cout << "WARNING: skip incomplete entry " << i
+				<< " in " << path << endl;
+			continue;
+		}
+
+		Job job;
+		job.Src = entry["file"][0];
+		if (!entry["directory"].empty())
+			job.Dir = entry["directory"][0];
+
+		/***** Drop the compiler and the output file *****/
+		job.Args = commonArgs;
+		for (vector<string>::size_type j = 1; j < words.size(); ++j) {
+			if (words[j] == "-o") {
+				j++;
+				continue;
+			}
+			if (words[j].compare(0, 2, "-o") == 0)
+				continue;
+			job.Args.push_back(words[j]);
+		}
+		jobs.push_back(job);
+	}
+}
+
+
+/****************************************
+ * fork and exec one worker
+ * Return:
+ *		pid_t: pid of the worker
+ ****************************************/
+static pid_t
+StartJob(const string &self, const Job &job, const Options &opts)
+{
+	vector<string> args;
+	args.push_back(self);
+	args.insert(args.end(), opts.WorkerOpts.begin(), opts.WorkerOpts.end());
+	args.insert(args.end(), job.Args.begin(), job.Args.end());
+	args.push_back("-nc2adios:manifest");
+	args.push_back(job.Manifest);
+	if (!job.Patch.empty()) {
+		args.push_back("-nc2adios:patch");
+		args.push_back(job.Patch);
+		/***** Paths relative to the final patch,
+				not to the worker's one *****/
+		args.push_back("-nc2adios:patch-base");
+		args.push_back(opts.PatchFile.substr(0, 
+			opts.PatchFile.rfind('/') + 1));
+	}
+	args.push_back("-rose:skipfinalCompileStep");
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		cout << "ERROR: fork failed. Quit." << endl;
+		exit(1);
+	}
+	if (pid > 0)
+		return pid;
+
+	/***** Child *****/
+	int fd = open(job.Log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd >= 0) {
+		dup2(fd, 1);
+		dup2(fd, 2);
+		close(fd);
+	}
+	if (!job.Dir.empty() && chdir(job.Dir.c_str()) != 0) {
+		perror(job.Dir.c_str());
+		_exit(127);
+	}
+
+	vector<char*> argv;
+	for (vector<string>::size_type i = 0; i < args.size(); ++i)
+		argv.push_back(const_cast<char*>(args[i].c_str()));
+	argv.push_back(NULL);
+
+	execv(self.c_str(), &argv[0]);
+	perror(self.c_str());
+	_exit(127);
+}
+
+
+/**************************************************
+ * Merge per-file group manifests into one
+ * Manifest line: group name, file name, source
+ **************************************************/
+int
+MergeManifests(const vector<Job> &jobs, const string &path)
+{
+	map<string, set<string> > groupSrcMap;
+	map<string, set<string> > groupFileMap;
+	string line, name, file, src;
+	int crossNum = 0;
+
+	for (vector<Job>::size_type i = 0; i < jobs.size(); ++i) {
+		ifstream in(jobs[i].Manifest.c_str());
+		while (getline(in, line)) {
+			istringstream fields(line);
+			if (!(getline(fields, name, '\t') && getline(fields, file, '\t')
+					&& getline(fields, src, '\t')))
+				continue;
+			groupSrcMap[name].insert(src);
+			groupFileMap[name].insert(file);
+		}
+		in.close();
+		remove(jobs[i].Manifest.c_str());
+	}
+
+	ofstream out(path.c_str());
+	for (map<string, set<string> >::iterator itr = groupSrcMap.begin();
+			itr != groupSrcMap.end(); ++itr) {
+		set<string> &files = groupFileMap[itr->first];
+
+		for (set<string>::iterator fItr = files.begin();
+				fItr != files.end(); ++fItr)
+			for (set<string>::iterator sItr = itr->second.begin();
+					sItr != itr->second.end(); ++sItr)
+				out << itr->first << '\t' << *fItr << '\t' << *sItr << endl;
+
+		/***** One adios group declared by several units *****/
+		if (itr->second.size() > 1) {
+			crossNum++;
+			cout << "ERROR: group " << itr->first << " is declared in "
+				<< itr->second.size() << " translation units" << endl;
+			for (set<string>::iterator sItr = itr->second.begin();
+					sItr != itr->second.end(); ++sItr)
+				cout << "\t" << *sItr << endl;
+		}
+		if (files.size() > 1)
+			cout << "WARNING: group " << itr->first << " writes to "
+				<< files.size() << " different files" << endl;
+	}
+
+	cout << "Group manifest: " << path << " (" << groupSrcMap.size()
+		<< " groups, " << crossNum << " cross-file)" << endl;
+
+	return crossNum;
+}
+
+
+/**************************************************
+ * Concatenate per-file patches in job order
+ **************************************************/
+static void
+MergePatches(const vector<Job> &jobs, const string &path)
+{
+	ofstream out(path.c_str());
+
+	for (vector<Job>::size_type i = 0; i < jobs.size(); ++i) {
+		ifstream in(jobs[i].Patch.c_str());
+		if (in && in.peek() != EOF)
+			out << in.rdbuf();
+		in.close();
+		remove(jobs[i].Patch.c_str());
+	}
+
+	cout << "Patch: " << path << endl;
+}
+
+
+/**************************************************
+ * Driver mode
+ **************************************************/
+int
+RunDriver(const vector<string> &argvList, const Options &opts)
+{
+	vector<string> commonArgs(argvList.begin()+1, argvList.end());
+	vector<Job> jobs;
+
+	if (!opts.FileList.empty())
+		ReadFileList(opts.FileList, commonArgs, jobs);
+	if (!opts.CompDB.empty())
+		ReadCompDB(opts.CompDB, commonArgs, jobs);
+
+	/***** Worker number *****/
+	int jobNum = opts.Jobs;
+	if (jobNum <= 0)
+		jobNum = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobNum <= 0)
+		jobNum = 1;
+
+	/***** Absolute paths, workers may chdir *****/
+	string self = SelfPath();
+	string cwd = CurrentDir();
+	for (vector<Job>::size_type i = 0; i < jobs.size(); ++i) {
+		char suffix[64];
+		snprintf(suffix, 64, ".%d.%d", (int)getpid(), (int)i);
+		jobs[i].Manifest = cwd + "/.nc2adios_groups" + suffix;
+		jobs[i].Log = cwd + "/.nc2adios_log" + suffix;
+		if (!opts.PatchFile.empty())
+			jobs[i].Patch = cwd + "/.nc2adios_patch" + suffix;
+	}
+
+	cout << "Translating " << jobs.size() << " files with "
+		<< jobNum << " workers" << endl;
+
+	/***** Worker pool *****/
+	map<pid_t, vector<Job>::size_type> runMap;
+	vector<Job>::size_type next = 0;
+	int failNum = 0;
+
+	while (next < jobs.size() || !runMap.empty()) {
+		while (next < jobs.size() && (int)runMap.size() < jobNum) {
+			runMap[StartJob(self, jobs[next], opts)] = next;
+			next++;
+		}
+
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0)
+			break;
+		map<pid_t, vector<Job>::size_type>::iterator itr = runMap.find(pid);
+		if (itr == runMap.end())
+			continue;
+
+		const Job &job = jobs[itr->second];
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+			cout << "\tdone: " << job.Src << endl;
+			/***** In scan mode the log is the report *****/
+			if (opts.Scan) {
+				ifstream log(job.Log.c_str());
+				cout << log.rdbuf();
+			}
+			remove(job.Log.c_str());
+		} else {
+			cout << "\tFAILED: " << job.Src << " (log: " << job.Log
+				<< ")" << endl;
+			failNum++;
+		}
+		runMap.erase(itr);
+	}
+
+	/***** Merge pass: an adios group declared by
+			several units would be declared, sized
+			and written by each of them *****/
+	int crossNum = MergeManifests(jobs,
+		opts.Manifest.empty() ? string("nc2adios.groups") : opts.Manifest);
+
+	if (!opts.PatchFile.empty())
+		MergePatches(jobs, opts.PatchFile);
+
+	if (failNum > 0) {
+		cout << failNum << " of " << jobs.size() << " files failed" << endl;
+		return 1;
+	}
+	if (crossNum > 0) {
+		cout << crossNum << " groups declared in several translation units,"
+			<< " give their files distinct names"
+			<< endl;
+		return 1;
+	}
+	return 0;
+}
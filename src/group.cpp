@@ -1,3 +1,4 @@
+#include <sstream>
 #include "group.h"
 
 using namespace std;
@@ -9,10 +10,14 @@ using namespace SageInterface;
 /**********************************************
  * Constructor
  **********************************************/
-Group::Group(vector<SgFunctionCallExp*> vec, 
-		const map<string, FUNC> &nameIndMap, int id) 
-	: Name("DefaultGroup"), FileName("DefaultFile"), GroupID(id),
-		CommExp(NULL), FuncNameIndMap(&nameIndMap)
+Group::Group(const vector<SgFunctionCallExp*> &vec, 
+		const map<string, FUNC> &nameIndMap, int id, const Options &opts) 
+	: Name("DefaultGroup"), FileName("DefaultFile"),
+		RolloverSteps(0), RolloverMB(0), RolloverManifest(false),
+		GroupID(id), CommExp(NULL), IsRead(false), StatsOn(true),
+		HasStatsGroup(false), FuncNameIndMap(&nameIndMap), Opts(&opts),
+		ErrVec(NULL), IdNum(0), StatsIdNum(0),
+		Leader(NULL), Opener(NULL), Closer(NULL)
 {
 	cout << "FuncNameIndMap size: " << FuncNameIndMap->size() << endl;
 
@@ -20,6 +25,13 @@ Group::Group(vector<SgFunctionCallExp*> vec,
 	snprintf(groupIDStr, 30, "%d", GroupID); 
 	GroupIDVar = string("adios_group") + groupIDStr;
 	FileVar = string("adios_file") + groupIDStr;
+	StatsGroupIDVar = GroupIDVar + "_stats";
+	StatsFileVar = FileVar + "_stats";
+	RankVar = string("adios_rank") + groupIDStr;
+	RFileVar = string("adios_rfile") + groupIDStr;
+	StepVar = string("adios_step") + groupIDStr;
+	PieceVar = string("adios_piece") + groupIDStr;
+	BytesVar = string("adios_bytes") + groupIDStr;
 
 	CallVV.resize(FuncNameIndMap->size());
 	cout << "Initializing CallVV..." << endl;
@@ -51,7 +63,7 @@ Group::Group(vector<SgFunctionCallExp*> vec,
  *		vector< vector<SgFunctionCallExp*> > CallVV
  **************************************************/
 void 
-Group::InitCallVV(vector<SgFunctionCallExp*> vec)
+Group::InitCallVV(const vector<SgFunctionCallExp*> &vec)
 {
 	map<string, FUNC>::const_iterator mapItr;
 	string funcName;
@@ -59,6 +71,7 @@ Group::InitCallVV(vector<SgFunctionCallExp*> vec)
 	for (vector<SgFunctionCallExp*>::size_type i = 0;
 			i != vec.size(); ++i) {
 		funcName = GetCallName(vec[i]);
+		CallSeq[vec[i]] = i;
 		if ( (mapItr = FuncNameIndMap->find(funcName)) 
 				!= FuncNameIndMap->end() ) 
 			CallVV[mapItr->second].push_back(vec[i]);
@@ -66,6 +79,176 @@ Group::InitCallVV(vector<SgFunctionCallExp*> vec)
 }
 
 
+/************************************
+ * Adios group and file the calls of
+ * the group go to: the leader's when
+ * fused
+ ************************************/
+string
+Group::GetName() const
+{
+	return (Leader != NULL) ? Leader->Name : Name;
+}
+
+string
+Group::GetFileName() const
+{
+	return (Leader != NULL) ? Leader->FileName : FileName;
+}
+
+/************************************
+ * Transport method, its parameters and
+ * the buffer size from the profile.
+ * Staged files are always written
+ * with POSIX.
+ ************************************/
+string
+Group::GetMethod() const
+{
+	if (IsStaged())
+		return "POSIX";
+	return Opts->Prof.GetStr("method", "MPI");
+}
+
+string
+Group::GetMethodParams() const
+{
+	return Opts->Prof.GetLine("method_params", "");
+}
+
+int
+Group::GetBufferMB() const
+{
+	return Opts->Prof.GetInt("buffer_mb", 10);
+}
+
+/************************************
+ * Node-local burst buffer directory:
+ *		stage <dir>
+ * empty = files go straight to their
+ * final location
+ ************************************/
+string
+Group::GetStageDir() const
+{
+	return Opts->Prof.GetStr("stage", "");
+}
+
+bool
+Group::IsStaged() const
+{
+	return !GetStageDir().empty();
+}
+
+/************************************
+ * Source file of the nc create call
+ ************************************/
+string
+Group::GetSrcFileName() const
+{
+	if (IsPara)
+		return GetCallFileName(CallVV[NC_CREATE_PAR][0]);
+	else
+		return GetCallFileName(CallVV[NC_CREATE][0]);
+}
+
+
+/**********************************************
+ * Write the adios-group and method elements
+ * of an adios XML config, mirroring what the
+ * noxml code path defines
+ **********************************************/
+void
+Group::WriteXml(ostream &out) const
+{
+	/***** Fused: the leader writes the group *****/
+	if (Leader != NULL && Leader != this)
+		return;
+
+	WriteXmlGroup(out, Name, StatsOn, false);
+	if (HasStatsGroup)
+		WriteXmlGroup(out, StatsName, true, true);
+}
+
+
+void
+Group::WriteXmlGroup(ostream &out, const string &name, bool stats,
+	bool statsGroup) const
+{
+	out << "  <adios-group name=\"" << name
+		<< "\" coordination-communicator=\"comm\" stats=\""
+		<< (stats ? "On" : "Off") << "\">" << endl;
+
+	if (FusedVec.empty())
+		WriteXmlVars(out, statsGroup);
+	for (vector<Group*>::size_type i = 0; i < FusedVec.size(); ++i)
+		FusedVec[i]->WriteXmlVars(out, statsGroup);
+
+	out << "  </adios-group>" << endl;
+
+	out << "  <method group=\"" << name << "\" method=\"" << GetMethod()
+		<< "\">" << GetMethodParams() << "</method>" << endl;
+}
+
+
+void
+Group::WriteXmlVars(ostream &out, bool statsGroup) const
+{
+	vector<string> dimVec = GetAllDims();
+	set<string> dimSet(dimVec.begin(), dimVec.end()), countSet, offsetSet;
+
+	for (map<SgInitializedName*, VarSec>::const_iterator
+			itr = VarMap.begin(); itr != VarMap.end(); ++itr) {
+		if (InStatsGroup(itr->second) != statsGroup || 
+				itr->second.IsReplicated)
+			continue;
+		vector<string> dimVec = itr->second.GetDimVec();
+		for (vector<string>::size_type i = 0; i < dimVec.size(); ++i) {
+			countSet.insert("c" + dimVec[i]);
+			offsetSet.insert("o" + dimVec[i]);
+		}
+	}
+
+	for (set<string>::iterator itr = dimSet.begin(); 
+			itr != dimSet.end(); ++itr)
+		out << "    <var name=\"" << AdPath(*itr)
+			<< "\" type=\"unsigned long\"/>" << endl;
+	for (set<string>::iterator itr = countSet.begin(); 
+			itr != countSet.end(); ++itr)
+		out << "    <var name=\"" << AdPath(*itr)
+			<< "\" type=\"unsigned integer\"/>" << endl;
+	for (set<string>::iterator itr = offsetSet.begin(); 
+			itr != offsetSet.end(); ++itr)
+		out << "    <var name=\"" << AdPath(*itr)
+			<< "\" type=\"unsigned integer\"/>" << endl;
+
+	for (map<SgInitializedName*, VarSec>::const_iterator
+			itr = VarMap.begin(); itr != VarMap.end(); ++itr) {
+		const VarSec &var = itr->second;
+		if (InStatsGroup(var) != statsGroup)
+			continue;
+		if (var.IsReplicated) {
+			out << "    <var name=\"" << AdPath(var.Name) << "\" type=\""
+				<< GetXmlTypeName(var.TypeStr) << "\" dimensions=\""
+				<< AdPathList(MakeStr(var.StrVec, "")) << "\"/>" << endl;
+			continue;
+		}
+		vector<string> dimVec = var.GetDimVec();
+		out << "    <global-bounds dimensions=\"" 
+			<< AdPathList(MakeStr(dimVec, "")) << "\" offsets=\"" 
+			<< AdPathList(MakeStr(dimVec, "o")) << "\">" << endl;
+		out << "      <var name=\"" << AdPath(var.Name) << "\" type=\""
+			<< GetXmlTypeName(var.TypeStr) << "\" dimensions=\""
+			<< AdPathList(MakeStr(dimVec, "c")) << "\"/>" << endl;
+		out << "    </global-bounds>" << endl;
+		for (vector<string>::size_type i = 0; i < var.Reductions.size(); ++i)
+			out << "    <var name=\"" 
+				<< AdPath(var.Name + "_" + var.Reductions[i])
+				<< "\" type=\"double\"/>" << endl;
+	}
+}
+
+
 /************************************************
  * Get adios group name and output file name
  * based on NetCDF output file name
@@ -99,17 +282,18 @@ Group::GetNames(const string &path)
 
 
 /*********************************************
-  * Process nc_create_par function calls
+  * Extract info from nc_create_par function calls
   * There should only one nc_create_par call
   * Output:
   *		string Name: group name
   *		string FileName: output file name
   *		int Cmode: nc create par mode
+  *		SgExpression *CommExp: communicator
   *******************************************/
 void
-Group::Process_nc_create_par()
+Group::Extract_nc_create_par()
 {
-	vector<SgFunctionCallExp*> vec = CallVV[NC_CREATE_PAR];
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_CREATE_PAR];
 	assert(vec.size() == 1);
 
 	string path, pathVar;
@@ -139,18 +323,27 @@ Group::Process_nc_create_par()
 	} else if (cmodeExp->variantT() == V_SgIntVal) {
 		Cmode = ArgEnum(cmodeExp);
 	} else {
-		cout << "ERROR: unsupported cmodeExp class name: "
-				<< cmodeExp->class_name() << endl;
-		exit(1);
+		Error("unsupported cmodeExp class name: " + cmodeExp->class_name());
+		return;
 	}
 	cout << "\tcmode value: " << Cmode << endl;
 
 	/***** comm *****/
 	CommExp = GetCallArgs(vec[0])[2];
+}
 
 
+/*********************************************
+  * Process nc_create_par function calls
+  * There should only one nc_create_par call
+  *******************************************/
+void
+Group::Process_nc_create_par()
+{
 	/***** Insert adios calls, some var decls, remove nc call *****/
-	InsertAdiosInit();
+	StmtBatch batch;
+	InsertAdiosInit(batch);
+	batch.Flush();
 
 }
 
@@ -167,7 +360,7 @@ Group::Process_nc_create_par()
   *		int Cmode: nc create mode
   *******************************************/
 void
-Group::Extract_nc_create(vector<SgFunctionCallExp*> vec)
+Group::Extract_nc_create(const vector<SgFunctionCallExp*> &vec)
 {
 	assert(vec.size() == 1);
 
@@ -199,83 +392,84 @@ Group::Extract_nc_create(vector<SgFunctionCallExp*> vec)
 
 /**********************************************
  * Extract info from nc_def_dim function calls
- * Input:
- *		vector<SgFunctionCallExp*> vec:
- *			nc_def_dim call vector
  * Output:
- *		map<SgInitializedName*, string> DimMap:
+ *		map<SgInitializedName*, vector<string> > DimMap:
  *			dim info 
  **********************************************/
 void
-Group::Extract_nc_def_dim(vector<SgFunctionCallExp*> vec)
+Group::Extract_nc_def_dim()
 {
-
-	string name, nameVar, lenVar, idpVar;
-	size_t len;
-	
-	SgExpression *nameExp, *lenExp, *idpExp;
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_DEF_DIM];
 
 	cout << "nc_def_dim is called " << vec.size() 
 			<< " times"  << endl;
 
-	for (vector<SgFunctionCallExp*>::size_type i = 0; i != vec.size(); ++i) {
-		cout << "    time " << i << endl;
-
-		/**** name *****/
-		nameExp = GetCallArgs(vec[i])[1];
-		name = ArgCharPtr(nameExp, nameVar);
-
-		if (!name.empty()) {
-			cout << "\tdim name: " << name << endl;
-		} else {
-			cout << "\tdim name is in var: " << nameVar << endl;
-		}
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		ExtractOne_nc_def_dim(vec[i]);
+	}
+}
 
-		/***** len *****/
-		lenExp = GetCallArgs(vec[i])[2];
-		len = ArgSize_t(lenExp, lenVar);
 
-		if (len > 0) {
-			cout << "\tlen: " << len << endl;
-		} else {
-			cout << "\tlen is in var: " << lenVar << endl;
-		}
+/**********************************************
+ * Adios name of the dim of a nc_def_dim call:
+ * its name, or the name of the var holding it
+ **********************************************/
+static string
+GetDimAdName(SgFunctionCallExp *callExp)
+{
+	string name, nameVar;
 
-		/***** idp *****/
-		idpExp =  GetCallArgs(vec[i])[3];
-		idpVar = ArgIntPtr(idpExp);
-		cout << "\tidp is in var: " << idpVar << endl;
+	name = ArgCharPtr(GetCallArgs(callExp)[1], nameVar);
+	if (!name.empty()) {
+		cout << "\tdim name: " << name << endl;
+		return name;
+	} else {
+		cout << "\tdim name is in var: " << nameVar << endl;
+		return nameVar;
 	}
-	
 }
 
-void 
-Group::ProcessOne_nc_def_dim(SgFunctionCallExp *callExp)
+
+/**********************************************
+ * Value of a constant dim length, 0 if it is
+ * not a literal
+ **********************************************/
+static unsigned long long
+GetConstLen(SgExpression *lenExp)
 {
+	while (isSgCastExp(lenExp) != NULL)
+		lenExp = isSgCastExp(lenExp)->get_operand();
+
+	if (isSgIntVal(lenExp) != NULL && isSgIntVal(lenExp)->get_value() > 0)
+		return isSgIntVal(lenExp)->get_value();
+	if (isSgUnsignedLongVal(lenExp) != NULL)
+		return isSgUnsignedLongVal(lenExp)->get_value();
+	return 0;
+}
 
-	SgStatement *orginStmt = getEnclosingStatement(callExp);
-	SgScopeStatement *scope = getScope(orginStmt);
-	pushScopeStack(scope);
 
-	SgExpression *nameExp, *lenExp, *idpExp;
+/**********************************************
+ * Extract info from one nc_def_dim call and
+ * record the dim in DimMap
+ * Return:
+ *		string: adios name of the dim
+ **********************************************/
+string
+Group::ExtractOne_nc_def_dim(SgFunctionCallExp *callExp)
+{
+	SgExpression *idpExp;
 	SgInitializedName *idpInitName;
-	string name, nameVar, adName;
+	string adName;
 	IDTYPE idType;
 	int idOffset = 0;			// in case of ARRAY_OTHER
 
-	nameExp = GetCallArgs(callExp)[1];
-	lenExp = GetCallArgs(callExp)[2];
 	idpExp = GetCallArgs(callExp)[3];
 
 	/***** name *****/
-	name = ArgCharPtr(nameExp, nameVar);
-	if (!name.empty()) {
-		cout << "\tdim name: " << name << endl;
-		adName = name;
-	} else {
-		cout << "\tdim name is in var: " << nameVar << endl;
-		adName = nameVar;
-	}
+	adName = GetDimAdName(callExp);
+	DimSeq.insert(make_pair(adName, GetSeq(callExp)));
+	DimLenMap.insert(make_pair(adName, GetConstLen(GetCallArgs(callExp)[2])));
 
 	/***** idp*****/
 	if (idpExp->variantT() == V_SgAddressOfOp) {
@@ -291,32 +485,10 @@ Group::ProcessOne_nc_def_dim(SgFunctionCallExp *callExp)
 		idOffset = ArgIntPtr_AddOp_Right(idpExp);
 		idType = ARRAY_OTHER;
 	} else {
-		cout << "ERROR: unsupported idpExp class name: "
-				<< idpExp->class_name() << endl;
-		exit(1);
+		Error("unsupported idpExp class name: " + idpExp->class_name());
+		return adName;
 	}
 
-
-	/***** unsigned long long adName = len *****/
-	SgVariableDeclaration *adVarDecl = 
-		buildVariableDeclaration(adName,
-			buildUnsignedLongLongType(),
-			buildAssignInitializer(copyExpression(lenExp))
-			);
-
-
-	/***** adios_define_var (GroupIDVar, adName ,"", 
-			adios_unsigned_long, "", "", "") *****/
-	SgExprStatement *adDefVarCall = 
-		BuildAdDefVar(adName, "adios_unsigned_long");
-
-
-	/***** Insert, remove calls and pop scope *****/
-	insertStatementAfter(orginStmt, adVarDecl);
-	insertStatementAfter(adVarDecl, adDefVarCall);
-	removeStatement(orginStmt);
-	popScopeStack();
-	
 	/***** SINGLE, then append to DimMap *****/
 	if (idType == SINGLE) {
 		DimMap.insert(make_pair(idpInitName, vector<string>(1, adName))); 
@@ -340,23 +512,72 @@ Group::ProcessOne_nc_def_dim(SgFunctionCallExp *callExp)
 		}
 	}
 
+	return adName;
+}
+
+
+void 
+Group::ProcessOne_nc_def_dim(SgFunctionCallExp *callExp, StmtBatch &batch)
+{
+
+	SgStatement *orginStmt = getEnclosingStatement(callExp);
+	SgScopeStatement *scope = getScope(orginStmt);
+	pushScopeStack(scope);
+
+	SgExpression *lenExp = GetCallArgs(callExp)[2];
+	string adName = GetDimAdName(callExp);
+
+
+	/***** unsigned long long adName = len *****/
+	SgVariableDeclaration *adVarDecl = 
+		buildVariableDeclaration(adName,
+			buildUnsignedLongLongType(),
+			buildAssignInitializer(copyExpression(lenExp))
+			);
+
+
+	batch.InsertAfter(orginStmt, adVarDecl);
+
+	/***** adios_define_var (GroupIDVar, adName ,"", 
+			adios_unsigned_long, "", "", "") 
+			unless the XML config or the var table 
+			defines it *****/
+	if (Opts->XmlFile.empty() && !Opts->Tables) {
+		SgExprStatement *adDefVarCall = 
+			BuildAdDefVar(GroupIDVar, adName, "adios_unsigned_long",
+				"", "", "", IdMap[adName]);
+		batch.InsertAfter(adVarDecl, adDefVarCall);
+
+		/***** The stats group needs the dims too *****/
+		if (HasStatsGroup)
+			batch.InsertAfter(adDefVarCall, 
+				BuildAdDefVar(StatsGroupIDVar, adName, "adios_unsigned_long",
+					"", "", "", StatsIdMap[adName]));
+	}
+
+
+	/***** Remove calls and pop scope *****/
+	batch.Remove(orginStmt);
+	popScopeStack();
+
 }
 
 
 void
 Group::Process_nc_def_dim()
 {
-	vector<SgFunctionCallExp*> vec = CallVV[NC_DEF_DIM];
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_DEF_DIM];
+	StmtBatch batch;
 
 	for (vector<SgFunctionCallExp*>::size_type i = 0; 
 			i != vec.size(); ++i) {
-		ProcessOne_nc_def_dim(vec[i]);
+		ProcessOne_nc_def_dim(vec[i], batch);
 	}
-	
+	batch.Flush();
 }
 
 void 
-Group::ProcessOne_nc_def_var(SgFunctionCallExp *callExp)
+Group::ProcessOne_nc_def_var(SgFunctionCallExp *callExp, StmtBatch &batch)
 {
 
 	SgStatement *orginStmt = getEnclosingStatement(callExp);
@@ -374,60 +595,126 @@ Group::ProcessOne_nc_def_var(SgFunctionCallExp *callExp)
 	map<SgInitializedName*, VarSec>::iterator itr 
 		= VarMap.find(varidInitName);
 	assert(itr != VarMap.end());
-	vector<string> strVec = itr->second.StrVec;
+	vector<string> strVec = itr->second.GetDimVec();
+
+	assert(itr->second.IsGlobal || itr->second.IsReplicated);
+
+	/***** Group the var is defined in *****/
+	string groupVar = GetVarGroupIDVar(itr->second);
+
+	/***** Decimated: global dims of the reduced var
+			unsigned long long <dim>_d<D> = (dim + D - 1) / D *****/
+	SgStatement *prevStmt = orginStmt;
+	for (vector<string>::size_type i = 0; 
+			i < strVec.size() && itr->second.Stride > 1; ++i) {
+		if (!ReducedDimSet.insert(strVec[i]).second)
+			continue;
+		SgVariableDeclaration *decl = 
+			buildVariableDeclaration(strVec[i], buildUnsignedLongLongType(),
+				buildAssignInitializer(
+					buildDivideOp(
+						buildAddOp(
+							buildVarRefExp(SgName(itr->second.StrVec[i])),
+							buildIntVal(itr->second.Stride - 1)
+						),
+						buildIntVal(itr->second.Stride)
+					)
+				)
+			);
+		batch.InsertAfter(prevStmt, decl);
+		prevStmt = decl;
+		if (!Opts->XmlFile.empty() || Opts->Tables)
+			continue;
+		/***** Both files get all dims written *****/
+		adDefVarCall = BuildAdDefVar(GroupIDVar, strVec[i], 
+			"adios_unsigned_long", "", "", "", IdMap[strVec[i]]);
+		batch.InsertAfter(prevStmt, adDefVarCall);
+		prevStmt = adDefVarCall;
+		if (HasStatsGroup) {
+			adDefVarCall = BuildAdDefVar(StatsGroupIDVar, strVec[i], 
+				"adios_unsigned_long", "", "", "", StatsIdMap[strVec[i]]);
+			batch.InsertAfter(prevStmt, adDefVarCall);
+			prevStmt = adDefVarCall;
+		}
+	}
+
+	/***** XML config or var table: defined there *****/
+	if (!Opts->XmlFile.empty() || Opts->Tables) {
+		batch.Remove(orginStmt);
+		popScopeStack();
+		return;
+	}
 
-	assert(itr->second.IsGlobal);
+	/***** Replicated: a local var of the full
+			dims, no count/offset vars *****/
+	if (itr->second.IsReplicated) {
+		adDefVarCall = 
+			BuildAdDefVar(groupVar, itr->second.Name, itr->second.TypeStr,
+				MakeStr(strVec, ""), "", "", itr->second.IdBase);
+		batch.InsertAfter(orginStmt, adDefVarCall);
+		batch.Remove(orginStmt);
+		popScopeStack();
+		return;
+	}
 
 	/* adios_define_var() for
 	 * Count, Offset var declarations */
 	/***** Count var declarations *****/
-	SgStatement *prevStmt = orginStmt;
 	for (vector<string>::size_type i = 0; 
 			i < strVec.size(); ++i) {
 		// Build
 		adDefVarCall = 
-			BuildAdDefVar("c"+strVec[i], "adios_unsigned_integer");
+			BuildAdDefVar(groupVar, "c"+strVec[i], "adios_unsigned_integer",
+				"", "", "", itr->second.IdBase + i);
 		// Insert
-		insertStatementAfter(prevStmt, adDefVarCall);
+		batch.InsertAfter(prevStmt, adDefVarCall);
 		prevStmt = adDefVarCall;
 	}
 
-	/***** Offset var declarations(Use a For Statement) *****/
-	SgForStatement *forStmt =
-		BuildCanonicalForStmt(0, itr->second.IterNum);
-	SgBasicBlock *forBody = 
-		isSgBasicBlock(forStmt->get_loop_body());
-	assert(forBody != NULL);
-	insertStatementAfter(prevStmt, forStmt);
-	pushScopeStack(forBody);
-
+	/***** Offset var declarations: once, as the
+			count vars. ADIOS resolves the offset
+			dims of the var by name to the first
+			definition, each put writes its block
+			offsets through that one ID *****/
 	for (vector<string>::size_type i = 0; 
 			i < strVec.size(); ++i) {
 		// Build
 		adDefVarCall = 
-			BuildAdDefVar("o"+strVec[i], "adios_unsigned_integer");
+			BuildAdDefVar(groupVar, "o"+strVec[i], "adios_unsigned_integer",
+				"", "", "", itr->second.IdBase + strVec.size() + i);
 		// Insert
-		appendStatement(adDefVarCall);
+		batch.InsertAfter(prevStmt, adDefVarCall);
+		prevStmt = adDefVarCall;
 	}
 
-	popScopeStack();
-
 
 
  	/***** adios_define_var (GroupIDVar, adName, "", 
  		adType, dims, "", "") ****/ 
 // 
 	adDefVarCall = 
-		BuildAdDefVar(itr->second.Name, itr->second.TypeStr, 
+		BuildAdDefVar(groupVar, itr->second.Name, itr->second.TypeStr, 
 			MakeStr(strVec, "c"), MakeStr(strVec, ""),
-			MakeStr(strVec, "o")
+			MakeStr(strVec, "o"), itr->second.IdBase + 2 * strVec.size()
 		);
 		
 
 	/***** Insert, remove and pop scope *****/
-	insertStatementAfter(forStmt, adDefVarCall);
+	batch.InsertAfter(prevStmt, adDefVarCall);
+
+	/***** Reductions: scalar doubles *****/
+	prevStmt = adDefVarCall;
+	for (vector<string>::size_type i = 0; 
+			i < itr->second.Reductions.size(); ++i) {
+		adDefVarCall = 
+			BuildAdDefVar(groupVar, 
+				itr->second.Name + "_" + itr->second.Reductions[i], 
+				"adios_double");
+		batch.InsertAfter(prevStmt, adDefVarCall);
+		prevStmt = adDefVarCall;
+	}
 //	insertStatementAfter(orginStmt, adDefVarCall);
-	removeStatement(orginStmt);
+	batch.Remove(orginStmt);
 	popScopeStack();
 	
 
@@ -436,13 +723,14 @@ Group::ProcessOne_nc_def_var(SgFunctionCallExp *callExp)
 void
 Group::Process_nc_def_var()
 {
-	vector<SgFunctionCallExp*> vec = CallVV[NC_DEF_VAR];
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_DEF_VAR];
+	StmtBatch batch;
 
 	for (vector<SgFunctionCallExp*>::size_type i = 0; 
 			i != vec.size(); ++i) {
-		ProcessOne_nc_def_var(vec[i]);
+		ProcessOne_nc_def_var(vec[i], batch);
 	}
-	
+	batch.Flush();
 }
 
 
@@ -481,9 +769,10 @@ Group::ExtractOne_nc_def_var(SgFunctionCallExp *callExp)
 		adType = "adios_real";
 		unitSize = 4;
 	} else {
-		cout << "ERROR: unsupported NetCDF xtype: " 
-			<< xtypeInt << " .Quit. " << endl;
-		exit(1);
+		ostringstream msg;
+		msg << "unsupported NetCDF xtype: " << xtypeInt;
+		Error(msg.str());
+		return;
 	}
 
 	// string xtypeMacroName;
@@ -521,114 +810,775 @@ Group::ExtractOne_nc_def_var(SgFunctionCallExp *callExp)
 		ArgIntPtr_InitName(varidpExp);
 
 	/***** Append to VarMap *****/
-	VarMap.insert( make_pair(varidInitName, 
-				VarSec(dimidspInitName, strVec, adName, adType, unitSize)) ); 
+	VarSec var(dimidspInitName, strVec, adName, adType, unitSize);
+	var.Stats = IsStatsVar(adName);
+	FillAnalysis(var);
+	FillReduction(var);
+	VarMap.insert(make_pair(varidInitName, var)); 
+
+	/***** Decimated dims are declared here *****/
+	vector<string> dimVec = var.GetDimVec();
+	for (vector<string>::size_type i = 0; 
+			i < dimVec.size() && var.Stride > 1; ++i)
+		DimSeq.insert(make_pair(dimVec[i], GetSeq(callExp)));
 
 }
 
 void
 Group::Extract_nc_def_var()
 {
-	vector<SgFunctionCallExp*> vec = CallVV[NC_DEF_VAR];
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_DEF_VAR];
 
 	for (vector<SgFunctionCallExp*>::size_type i = 0; 
 			i != vec.size(); ++i) {
 		ExtractOne_nc_def_var(vec[i]);
 	}
-	
+
+	FillStats();
+	FillRollover();
+
+	if (IsStaged() && Opts->Prof.GetStr("method", "POSIX") != "POSIX")
+		cout << "WARNING: group " << Name << " is staged in " 
+			<< GetStageDir() << ", method " 
+			<< Opts->Prof.GetStr("method", "") << " replaced by POSIX" 
+			<< endl;
 }
 
-/*****************************************
- * Update VarMap: Update IsGlobal, and 
- * fill CountInit, OffsetInit, IterNum
- * if necessary
- * Also, update PutVarVec
- ****************************************/
+
+/************************************************
+ * Fill StatsOn, HasStatsGroup and the stats 
+ * group names from the profile:
+ *		stats on|off				default of all groups
+ *		stats_group <group> on|off	one group
+ *		stats_var <var> ...			vars that need stats
+ * Vars that need stats in a group without them
+ * go to a companion group <Name>_stats with 
+ * statistics on, written to its own file
+ ************************************************/
 void
-Group::Extract_nc_put_vara_int()
+Group::FillStats()
 {
-	assert(CallVV[NC_PUT_VARA_INT].size() == 1);
-	PutVarVec.clear();
-	PutVarVec.resize(CallVV[NC_PUT_VARA_INT].size());
-	SgFunctionCallExp *callExp = CallVV[NC_PUT_VARA_INT][0];
-
-	SgExpression *varidExp, *startpExp, *countpExp;
-	SgInitializedName *varidInitName;
-
-	varidExp = GetCallArgs(callExp)[1];
-	startpExp = GetCallArgs(callExp)[2];
-	countpExp = GetCallArgs(callExp)[3];
+	const vector<Profile::Entry> &groupVec = 
+		Opts->Prof.GetAll("stats_group");
 
-	varidInitName = ArgVarRef_InitName(varidExp);
-	map<SgInitializedName*, VarSec>::iterator itr 
-		= VarMap.find(varidInitName);
-	assert(itr != VarMap.end());
-	vector<string>::size_type ndims = itr->second.StrVec.size();
+	StatsOn = (Opts->Prof.GetStr("stats", "on") != "off");
+	for (vector<Profile::Entry>::size_type i = 0; 
+			i < groupVec.size(); ++i)
+		if (groupVec[i].size() == 2 && groupVec[i][0] == Name)
+			StatsOn = (groupVec[i][1] != "off");
 
+	HasStatsGroup = false;
+	for (map<SgInitializedName*, VarSec>::iterator itr = VarMap.begin();
+			itr != VarMap.end(); ++itr)
+		if (!StatsOn && itr->second.Stats)
+			HasStatsGroup = true;
+
+	StatsName = Name + "_stats";
+	StatsFileName = FileName;
+	if ( (StatsFileName.length() > 3) && 
+			(StatsFileName.substr(StatsFileName.length()-3) == ".bp") )
+		StatsFileName.insert(StatsFileName.length()-3, "_stats");
+	else
+		StatsFileName += "_stats";
 
-	/***** IsGlobal *****/
-	itr->second.IsGlobal = true;
+	cout << "\tstatistics: " << (StatsOn ? "on" : "off") << endl;
+	if (HasStatsGroup)
+		cout << "\tstats group: " << StatsName << endl;
+}
 
 
-	/***** CountInit and OffsetInt *****/
-	SgType *startpType = ArgVarRef_Type(startpExp);
-	SgType *countpType = ArgVarRef_Type(countpExp);
-	assert(getDimensionCount(startpType) == 1);
-	assert(getDimensionCount(countpType) == 1);
-	assert(startpType->variantT() == V_SgArrayType);
-	assert(countpType->variantT() == V_SgArrayType);
-	assert(getArrayElementCount(static_cast<SgArrayType*>(startpType))
-		== ndims);
-	assert(getArrayElementCount(static_cast<SgArrayType*>(countpType))
-		== ndims);
-	itr->second.OffsetInit = ArgVarRef_InitName(startpExp);
-	itr->second.CountInit = ArgVarRef_InitName(countpExp);
+/************************************************
+ * Fill the rollover policy from the profile:
+ *		rollover <group> <N> [<MB>]		start a new
+ *			file after N puts (0 = no step limit)
+ *			or once MB of data went to the file
+ *		rollover_manifest on|off		list the
+ *			pieces in <file>.pieces, default off
+ * Pieces are named <file>.<piece>.bp
+ ************************************************/
+void
+Group::FillRollover()
+{
+	const vector<Profile::Entry> &vec = Opts->Prof.GetAll("rollover");
 
+	for (vector<Profile::Entry>::size_type i = 0; i < vec.size(); ++i) {
+		if (vec[i].size() < 2 || vec[i].size() > 3 || vec[i][0] != Name)
+			continue;
+		RolloverSteps = atoi(vec[i][1].c_str());
+		RolloverMB = (vec[i].size() == 3) ? atoi(vec[i][2].c_str()) : 0;
+	}
+	if (RolloverSteps < 0 || RolloverMB < 0) {
+		Error("bad rollover of group " + Name);
+		RolloverSteps = RolloverMB = 0;
+		return;
+	}
+	RolloverManifest = (Opts->Prof.GetStr("rollover_manifest", "off") 
+		== "on");
 
-	/***** IterNum *****/
-	int low, high;
-	SgStatement *orginStmt;
-	SgScopeStatement *scopeStmt;
+	if (HasRollover())
+		cout << "	rollover: " << RolloverSteps << " steps, " 
+			<< RolloverMB << " MB" << endl;
+}
 
-	orginStmt = getEnclosingStatement(callExp);
-	// scopeStmt = getScope(orginStmt);
-	// cout << "class name of scope of put function is " << 
-	// 	scopeStmt->class_name() << endl;;
-	scopeStmt = findEnclosingLoop(orginStmt);
-	SgForStatement *forStmt = isSgForStatement(scopeStmt);
-	assert(forStmt != NULL);
 
-	ExtractForStmtBounds(forStmt, low, high);
-	itr->second.IterNum = high - low;
-	cout << "Iteration number is: " << itr->second.IterNum << endl;
+/************************************************
+ * An error of the Extract_* analysis: quit, or
+ * in scan mode add it to ErrVec and go on
+ ************************************************/
+void
+Group::Error(const string &msg) const
+{
+	if (ErrVec != NULL) {
+		ErrVec->push_back(msg);
+		return;
+	}
+	cout << "ERROR: " << msg << " .Quit. " << endl;
+	exit(1);
+}
 
-	/***** Update PutVarVec *****/
-	PutVarVec[0] = itr->first;
 
+bool
+Group::HasRollover() const
+{
+	return RolloverSteps > 0 || RolloverMB > 0;
+}
+
+
+/************************************************
+ * Adios name of a var or dim: <Path>/<name> in
+ * a fused group, the name itself otherwise
+ ************************************************/
+string
+Group::AdPath(const string &name) const
+{
+	if (Path.empty())
+		return name;
+	return name.empty() ? Path : Path + "/" + name;
+}
+
+string
+Group::AdPathList(const string &list) const
+{
+	string str, item;
+	istringstream in(list);
+
+	while (getline(in, item, ','))
+		str += (str.empty() ? "" : ",") + AdPath(item);
+	return str;
+}
+
+
+/************************************************
+ * Source line of the first (or last) call, -1
+ * if there is none
+ ************************************************/
+int
+Group::GetLine(const vector<SgFunctionCallExp*> &vec, bool last)
+{
+	if (vec.empty())
+		return -1;
+	return GetCallFileLine(last ? vec.back() : vec.front());
+}
+
+
+/************************************************
+ * Fuse groups written together into one adios
+ * group and file, profile:
+ *		fuse <group> <group> ...
+ * Vars and dims of each group are named
+ * <group>/<name>. The group whose nc_create
+ * comes first declares the adios group, the one
+ * whose first nc_enddef comes last opens the file
+ * with the size of all of them and writes all
+ * dims, the one whose nc_close comes last closes
+ * it. The groups must be in one function. A
+ * step costs one open and one close.
+ ************************************************/
+void
+Group::Fuse(const vector<Group*> &groupVec)
+{
+	if (groupVec.empty())
+		return;
+	const vector<Profile::Entry> &fuseVec = 
+		groupVec[0]->Opts->Prof.GetAll("fuse");
+
+	for (vector<Profile::Entry>::size_type i = 0; i < fuseVec.size(); ++i) {
+		vector<Group*> vec;
+		for (Profile::Entry::size_type j = 0; j < fuseVec[i].size(); ++j)
+			for (vector<Group*>::size_type k = 0; k < groupVec.size(); ++k)
+				if (!groupVec[k]->IsReadGroup() && 
+						groupVec[k]->Name == fuseVec[i][j])
+					vec.push_back(groupVec[k]);
+		if (vec.size() < 2)
+			continue;
+
+		Group *leader = vec[0], *opener = vec[0], *closer = vec[0];
+		for (vector<Group*>::size_type j = 0; j < vec.size(); ++j) {
+			Group *g = vec[j];
+			if (g->Leader != NULL) {
+				cout << "ERROR: group " << g->Name << " fused twice .Quit. "
+					<< endl;
+				exit(1);
+			}
+			if (g->HasStatsGroup || g->HasRollover()) {
+				cout << "ERROR: group " << g->Name << ": stats_var and "
+					<< "rollover can NOT be used in a fused group .Quit. "
+					<< endl;
+				exit(1);
+			}
+			FUNC create = g->IsPara ? NC_CREATE_PAR : NC_CREATE;
+			FUNC leaderCreate = leader->IsPara ? NC_CREATE_PAR : NC_CREATE;
+			if (g->GetSrcFileName() != leader->GetSrcFileName() ||
+					getEnclosingFunctionDefinition(g->CallVV[create][0]) !=
+					getEnclosingFunctionDefinition(
+						leader->CallVV[leaderCreate][0])) {
+				cout << "ERROR: fused groups " << leader->Name << " and "
+					<< g->Name << " are in different functions .Quit. " 
+					<< endl;
+				exit(1);
+			}
+			if (GetLine(g->CallVV[create], false) < 
+					GetLine(leader->CallVV[leaderCreate], false))
+				leader = g;
+			if (GetLine(g->CallVV[NC_ENDDEF], false) > 
+					GetLine(opener->CallVV[NC_ENDDEF], false))
+				opener = g;
+			if (GetLine(g->CallVV[NC_CLOSE], true) > 
+					GetLine(closer->CallVV[NC_CLOSE], true))
+				closer = g;
+		}
+
+		cout << "fusing into group " << leader->Name << ":";
+		for (vector<Group*>::size_type j = 0; j < vec.size(); ++j) {
+			Group *g = vec[j];
+			cout << " " << g->Name;
+			g->Path = g->Name;
+			g->Leader = leader;
+			g->Opener = opener;
+			g->Closer = closer;
+			g->FusedVec = vec;
+			g->GroupIDVar = leader->GroupIDVar;
+			g->FileVar = leader->FileVar;
+			g->FillIds();
+		}
+		cout << endl;
+	}
+}
+
+
+/************************************************
+ * Whether the profile marks a var for stats
+ ************************************************/
+bool
+Group::IsStatsVar(const string &name) const
+{
+	const vector<Profile::Entry> &vec = Opts->Prof.GetAll("stats_var");
+
+	for (vector<Profile::Entry>::size_type i = 0; i < vec.size(); ++i)
+		if (find(vec[i].begin(), vec[i].end(), name) != vec[i].end())
+			return true;
+	return false;
+}
+
+
+/************************************************
+ * Adios group a var is defined in
+ ************************************************/
+bool
+Group::InStatsGroup(const VarSec &var) const
+{
+	return HasStatsGroup && var.Stats;
+}
+
+string
+Group::GetVarGroupIDVar(const VarSec &var) const
+{
+	return InStatsGroup(var) ? StatsGroupIDVar : GroupIDVar;
+}
+
+string
+Group::GetVarFileVar(const VarSec &var) const
+{
+	return InStatsGroup(var) ? StatsFileVar : FileVar;
+}
+
+/*****************************************
+ * Update VarMap: Update IsGlobal, and 
+ * fill CountInit, OffsetInit, IterNum
+ * if necessary
+ * Also, update PutVarVec
+ ****************************************/
+void
+Group::Extract_nc_put_vara_int()
+{
+	assert(CallVV[NC_PUT_VARA_INT].size() == 1);
+	PutVarVec.clear();
+	PutVarVec.resize(CallVV[NC_PUT_VARA_INT].size());
+	SgFunctionCallExp *callExp = CallVV[NC_PUT_VARA_INT][0];
+
+	SgExpression *varidExp, *startpExp, *countpExp;
+	SgInitializedName *varidInitName;
+
+	varidExp = GetCallArgs(callExp)[1];
+	startpExp = GetCallArgs(callExp)[2];
+	countpExp = GetCallArgs(callExp)[3];
+
+	varidInitName = ArgVarRef_InitName(varidExp);
+	map<SgInitializedName*, VarSec>::iterator itr 
+		= VarMap.find(varidInitName);
+	assert(itr != VarMap.end());
+	vector<string>::size_type ndims = itr->second.StrVec.size();
+
+
+	/***** IsGlobal *****/
+	itr->second.IsGlobal = true;
+
+
+	/***** CountInit and OffsetInt *****/
+	SgType *startpType = ArgVarRef_Type(startpExp);
+	SgType *countpType = ArgVarRef_Type(countpExp);
+	assert(getDimensionCount(startpType) == 1);
+	assert(getDimensionCount(countpType) == 1);
+	assert(startpType->variantT() == V_SgArrayType);
+	assert(countpType->variantT() == V_SgArrayType);
+	assert(getArrayElementCount(static_cast<SgArrayType*>(startpType))
+		== ndims);
+	assert(getArrayElementCount(static_cast<SgArrayType*>(countpType))
+		== ndims);
+	itr->second.OffsetInit = ArgVarRef_InitName(startpExp);
+	itr->second.CountInit = ArgVarRef_InitName(countpExp);
+
+
+	/***** IterNum *****/
+	int low, high;
+	SgStatement *orginStmt;
+
+	orginStmt = getEnclosingStatement(callExp);
+	// scopeStmt = getScope(orginStmt);
+	// cout << "class name of scope of put function is " << 
+	// 	scopeStmt->class_name() << endl;;
+
+	/***** In an OpenMP parallel region: one block
+			per rank, the loop is the one around the
+			region, and the count at nc_enddef is the
+			block of the rank, not a thread's tile *****/
+	SgStatement *region = GetOmpRegion(orginStmt);
+	if (region != NULL) {
+		if (isAncestor(region, itr->second.CountInit)) {
+			Error("count of " + itr->second.Name + " is declared in its "
+				"OpenMP region, the group size needs the block of the rank");
+			return;
+		}
+		/***** Nested teams reuse thread numbers,
+				their tiles would share slots *****/
+		if (GetOmpRegion(isSgStatement(region->get_parent())) != NULL) {
+			Error("put of " + itr->second.Name + " is in a nested "
+				"OpenMP parallel region");
+			return;
+		}
+		cout << "Put in an OpenMP parallel region" << endl;
+	}
+	SgForStatement *forStmt = GetPutLoop(orginStmt);
+	if (forStmt == NULL || !IsCanonicalForStmt(forStmt)) {
+		Error("put of " + itr->second.Name + " is not in a for loop with "
+			"constant bounds" + 
+			(region != NULL ? " around its OpenMP region" : ""));
+		return;
+	}
+
+	ExtractForStmtBounds(forStmt, low, high);
+	itr->second.IterNum = high - low;
+	cout << "Iteration number is: " << itr->second.IterNum << endl;
+
+	/***** Update PutVarVec *****/
+	PutVarVec[0] = itr->first;
+
+}
+
+
+/************************************************
+ * Extract info from nc_put_var_float calls
+ * They write the whole var: every rank holds it
+ * in full (coordinates, time values, parameters),
+ * so only rank 0 writes it.
+ * Output:
+ *		VarSec::IsReplicated, IterNum
+ ************************************************/
+void
+Group::Extract_nc_put_var_float()
+{
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_PUT_VAR_FLOAT];
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		SgFunctionCallExp *callExp = vec[i];
+		map<SgInitializedName*, VarSec>::iterator itr = 
+			VarMap.find(ArgVarRef_InitName(GetCallArgs(callExp)[1]));
+		assert(itr != VarMap.end());
+
+		if (itr->second.IsGlobal) {
+			Error("var " + itr->second.Name + 
+				" is written both in part and whole");
+			continue;
+		}
+		if (GetOmpRegion(getEnclosingStatement(callExp)) != NULL) {
+			Error("var " + itr->second.Name + " is written "
+				"whole in an OpenMP parallel region");
+			continue;
+		}
+		itr->second.IsReplicated = true;
+		if (itr->second.Stride > 1 || 
+				itr->second.MemTypeStr != itr->second.TypeStr) {
+			cout << "WARNING: var " << itr->second.Name << " is written "
+				<< "whole, decimate/precision ignored" << endl;
+			itr->second.Stride = 1;
+			itr->second.TypeStr = itr->second.MemTypeStr;
+			itr->second.UnitSize = 4;
+		}
+
+		/***** IterNum: iterations of a canonical
+				enclosing loop, else once *****/
+		SgForStatement *forStmt = isSgForStatement(
+			findEnclosingLoop(getEnclosingStatement(callExp)));
+		int low, high;
+		if (forStmt != NULL && IsCanonicalForStmt(forStmt)) {
+			ExtractForStmtBounds(forStmt, low, high);
+			itr->second.IterNum += high - low;
+		} else {
+			itr->second.IterNum += 1;
+		}
+		cout << "\treplicated var: " << itr->second.Name 
+			<< ", written " << itr->second.IterNum << " times" << endl;
+	}
+
+	if (HasRollover() && HasReplicated())
+		cout << "WARNING: group " << Name << " rolls over, its vars "
+			<< "written whole go only to the piece open at the time" << endl;
+}
+
+
+/************************************************
+ * nc_put_var_float(ncid, varid, op) becomes
+ *		if (adios_rankXX == 0)
+ *			adios_write(adios_fileXX, name, op);
+ ************************************************/
+void
+Group::Process_nc_put_var_float()
+{
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_PUT_VAR_FLOAT];
+	StmtBatch batch;
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		SgFunctionCallExp *callExp = vec[i];
+		SgStatement *orginStmt = getEnclosingStatement(callExp);
+		map<SgInitializedName*, VarSec>::iterator itr = 
+			VarMap.find(ArgVarRef_InitName(GetCallArgs(callExp)[1]));
+		assert(itr != VarMap.end());
+
+		SgScopeStatement *scope = getScope(orginStmt);
+		pushScopeStack(scope);
+
+		SgExprStatement *writeCall = 
+			BuildAdWrite(GetVarFileVar(itr->second), itr->second.Name,
+				copyExpression(GetCallArgs(callExp)[2]));
+
+		SgIfStmt *ifStmt = 
+			buildIfStmt(
+				buildEqualityOp(buildVarRefExp(SgName(RankVar)), 
+					buildIntVal(0)),
+				buildBasicBlock(writeCall),
+				NULL
+			);
+
+		batch.Replace(orginStmt, ifStmt);
+		popScopeStack();
+	}
+	batch.Flush();
+}
+
+
+bool
+Group::HasReplicated() const
+{
+	for (map<SgInitializedName*, VarSec>::const_iterator 
+			itr = VarMap.begin(); itr != VarMap.end(); ++itr)
+		if (itr->second.IsReplicated)
+			return true;
+	return false;
+}
+
+
+bool
+Group::HasReductions() const
+{
+	for (map<SgInitializedName*, VarSec>::const_iterator 
+			itr = VarMap.begin(); itr != VarMap.end(); ++itr)
+		if (!itr->second.Reductions.empty())
+			return true;
+	return false;
+}
+
+
+/************************************************
+ * Fill Analyze and Reductions of a var from the
+ * profile:
+ *		analysis <var> [min] [max] [sum] [mean]
+ * The var is handed to the registered analysis
+ * callbacks at each put; each reduction is
+ * written as a double var <var>_<reduction>
+ ************************************************/
+void
+Group::FillAnalysis(VarSec &var) const
+{
+	const vector<Profile::Entry> &vec = Opts->Prof.GetAll("analysis");
+
+	for (vector<Profile::Entry>::size_type i = 0; i < vec.size(); ++i) {
+		if (vec[i].empty() || vec[i][0] != var.Name)
+			continue;
+		var.Analyze = true;
+		for (Profile::Entry::size_type j = 1; j < vec[i].size(); ++j) {
+			if (GetReductionMacro(vec[i][j]).empty()) {
+				Error("unknown reduction " + vec[i][j] + " of var " + 
+					var.Name);
+				continue;
+			}
+			if (find(var.Reductions.begin(), var.Reductions.end(), 
+					vec[i][j]) == var.Reductions.end())
+				var.Reductions.push_back(vec[i][j]);
+		}
+	}
+}
+
+
+/************************************************
+ * Fill the reduction stage of a var from the
+ * profile:
+ *		decimate <var> <D>			keep every D-th 
+ *									element of each dim
+ *		precision <var> short|half	store narrower
+ * TypeStr and UnitSize become those of the
+ * stored data, MemTypeStr stays the put buffer's
+ ************************************************/
+void
+Group::FillReduction(VarSec &var) const
+{
+	const vector<Profile::Entry> &decVec = Opts->Prof.GetAll("decimate");
+	const vector<Profile::Entry> &preVec = Opts->Prof.GetAll("precision");
+
+	for (vector<Profile::Entry>::size_type i = 0; i < decVec.size(); ++i)
+		if (decVec[i].size() == 2 && decVec[i][0] == var.Name)
+			var.Stride = atoi(decVec[i][1].c_str());
+	if (var.Stride < 1) {
+		Error("bad decimation of var " + var.Name);
+		var.Stride = 1;
+	}
+
+	for (vector<Profile::Entry>::size_type i = 0; i < preVec.size(); ++i) {
+		if (preVec[i].size() != 2 || preVec[i][0] != var.Name)
+			continue;
+		/***** Only to a narrower type *****/
+		if (var.MemTypeStr == "adios_integer" && preVec[i][1] == "short") {
+			var.TypeStr = "adios_short";
+			var.UnitSize = 2;
+		} else if (var.MemTypeStr == "adios_real" && 
+				preVec[i][1] == "half") {
+			var.TypeStr = "adios_unsigned_short";	// IEEE half bits
+			var.UnitSize = 2;
+		} else {
+			Error("can NOT store var " + var.Name + " of " + 
+				var.MemTypeStr + " as " + preVec[i][1]);
+		}
+	}
+}
+
+
+/************************************************
+ * Runtime element type macro of an adios type
+ ************************************************/
+string
+Group::GetRtTypeMacro(const string &typeStr)
+{
+	if (typeStr == "adios_real")
+		return "NC2ADIOS_FLOAT";
+	if (typeStr == "adios_double")
+		return "NC2ADIOS_DOUBLE";
+	if (typeStr == "adios_short")
+		return "NC2ADIOS_SHORT";
+	if (typeStr == "adios_unsigned_short")
+		return "NC2ADIOS_HALF";
+	return "NC2ADIOS_INT";
+}
+
+
+/************************************************
+ * Runtime mask macro of a reduction, empty if
+ * there is no such reduction
+ ************************************************/
+string
+Group::GetReductionMacro(const string &reduction)
+{
+	if (reduction == "min")
+		return "NC2ADIOS_MIN";
+	if (reduction == "max")
+		return "NC2ADIOS_MAX";
+	if (reduction == "sum")
+		return "NC2ADIOS_SUM";
+	if (reduction == "mean")
+		return "NC2ADIOS_MEAN";
+	return string();
+}
+
+
+/************************************************
+ * nc_redef/nc_enddef pairing, in source order:
+ * each nc_enddef after the first closes an
+ * nc_redef between it and the one before, and
+ * each nc_redef is closed by a later nc_enddef.
+ * Several nc_redef (e.g. one per branch) may
+ * share one nc_enddef. Errors go to Error.
+ ************************************************/
+void
+Group::CheckRedefPairs() const
+{
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_ENDDEF];
+	const vector<SgFunctionCallExp*> &redefVec = CallVV[NC_REDEF];
+
+	if (vec.empty())
+		return;
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; i < vec.size(); ++i) {
+		int low = (i == 0) ? -1 : GetSeq(vec[i-1]);
+		bool closes = (i == 0);
+		for (vector<SgFunctionCallExp*>::size_type j = 0; 
+				j < redefVec.size(); ++j)
+			if (GetSeq(redefVec[j]) > low && 
+					GetSeq(redefVec[j]) < GetSeq(vec[i]))
+				closes = true;
+		if (!closes) {
+			ostringstream msg;
+			msg << "nc_enddef (line:" << vec[i]->get_file_info()->get_line()
+				<< ") of group " << Name << " closes no nc_redef; one "
+				<< "nc_enddef per branch is not supported";
+			Error(msg.str());
+		}
+	}
+	for (vector<SgFunctionCallExp*>::size_type j = 0; 
+			j < redefVec.size(); ++j)
+		if (GetSeq(redefVec[j]) > GetSeq(vec.back())) {
+			ostringstream msg;
+			msg << "nc_redef (line:" 
+				<< redefVec[j]->get_file_info()->get_line() << ") of group " 
+				<< Name << " is not closed by an nc_enddef";
+			Error(msg.str());
+		}
 }
 
 
 void 
 Group::Process_nc_enddef()
 {
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_ENDDEF];
 	SgStatement *orginStmt;
-	assert(CallVV[NC_ENDDEF].size() == 1);
-	orginStmt = getEnclosingStatement(CallVV[NC_ENDDEF][0]);
+	StmtBatch batch;
+	assert(!vec.empty());
+	CheckRedefPairs();
+
+	/***** Closing a redef: the vars defined in it
+			already have their adios_define_var, only
+			the dims declared since the previous
+			nc_enddef need writing *****/
+	for (vector<SgFunctionCallExp*>::size_type i = 1; i < vec.size(); ++i) {
+		orginStmt = getEnclosingStatement(vec[i]);
+		pushScopeStack(getScope(orginStmt));
+		SgStatement *prevStmt = InsertDimWrites(orginStmt, FileVar, 
+			GetSeq(vec[i-1]), GetSeq(vec[i]), batch);
+		if (HasStatsGroup)
+			InsertDimWrites(prevStmt, StatsFileVar, 
+				GetSeq(vec[i-1]), GetSeq(vec[i]), batch);
+		batch.Remove(orginStmt);
+		popScopeStack();
+	}
+
+	/***** First nc_enddef: open the file(s) *****/
+	orginStmt = getEnclosingStatement(vec[0]);
 
 	SgScopeStatement *scope = getScope(orginStmt);
 	pushScopeStack(scope);
 
-	/***** adios_open(&FileVar, Name, FileName, "w", CommExp) *****/
-	SgExprStatement *adOpenCall= BuildAdOpen();
+	/***** Var tables: static const descriptor
+			arrays, and one runtime call per group
+			defines all vars (noxml) *****/
+	SgStatement *prevStmt = orginStmt;
+	if (Opts->Tables) {
+		InsertRuntimeHeader(orginStmt);
+		SgVariableDeclaration *table = BuildVarTable("", false);
+		batch.InsertAfter(prevStmt, table);
+		prevStmt = table;
+		if (HasStatsGroup) {
+			table = BuildVarTable("_stats", true);
+			batch.InsertAfter(prevStmt, table);
+			prevStmt = table;
+		}
+		if (Opts->XmlFile.empty()) {
+			SgExprStatement *defCall = BuildDefineVars(GroupIDVar, "", false);
+			batch.InsertAfter(prevStmt, defCall);
+			prevStmt = defCall;
+			if (HasStatsGroup) {
+				defCall = BuildDefineVars(StatsGroupIDVar, "_stats", true);
+				batch.InsertAfter(prevStmt, defCall);
+				prevStmt = defCall;
+			}
+		}
+	}
+
+	/***** Fused: only the last group to reach its
+			nc_enddef opens the file *****/
+	if (Opener != NULL && Opener != this) {
+		InsertGroupSize(prevStmt, "", false, batch);
+		batch.Remove(orginStmt);
+		batch.Flush();
+		popScopeStack();
+		return;
+	}
+
+	/***** Open the file(s) *****/
+	prevStmt = InsertAdOpen(prevStmt, FileVar, GetName(), GetFileName(), "", 
+		false, GetSeq(vec[0]), batch);
+	if (HasStatsGroup)
+		InsertAdOpen(prevStmt, StatsFileVar, StatsName, StatsFileName,
+			"_stats", true, GetSeq(vec[0]), batch);
 
 
+	/***** remove original statement *****/
+	batch.Remove(orginStmt);
+	batch.Flush();
+
+	popScopeStack();
+
+}
+
+
+/************************************************
+ * Declare and compute the group size of one
+ * adios group after prevStmt
+ *		unsigned long long adios_groupsizeXX,
+ *			adios_totalsizeXX;
+ *		adios_groupsizeXX = ...;
+ * Return:
+ *		SgStatement *: last inserted statement
+ ************************************************/
+SgStatement *
+Group::InsertGroupSize(SgStatement *prevStmt, const string &suffix,
+	bool statsGroup, StmtBatch &batch)
+{
 	/***** Var declarations *****/
 	char groupIDStr[30];
 	snprintf(groupIDStr, 30, "%d", GroupID); 
 	string adios_groupsize_str =
-		string("adios_groupsize") + groupIDStr;
+		string("adios_groupsize") + groupIDStr + suffix;
 	string adios_totalsize_str = 
-		string("adios_totalsize") + groupIDStr;
+		string("adios_totalsize") + groupIDStr + suffix;
 	/***** unsigned long long adios_groupsizeXX *****/
 	SgVariableDeclaration *adios_groupsize_decl = 
 		buildVariableDeclaration(adios_groupsize_str,
@@ -638,152 +1588,931 @@ Group::Process_nc_enddef()
 		buildVariableDeclaration(adios_totalsize_str,
 			buildUnsignedLongLongType());
 
+	batch.InsertAfter(prevStmt, adios_groupsize_decl);
+	batch.InsertAfter(adios_groupsize_decl, adios_totalsize_decl);
+
+	/* adios_groupsizeXX = ndims*8(g) + ndims*4(c)*IterNum 
+	 * + ndims*4(o)*IterNum + count * UnitSize(data) * IterNum */
+	if (Opts->Tables)
+		return InsertGroupSizeTable(adios_totalsize_decl, adios_groupsize_str,
+			suffix, statsGroup, batch);
 
-	/* adios_groupsizeXX = ndims*8(g) + ndims*4(c) + ndims*4(o)*IterNum
-	 * + count * UnitSize(data) * IterNum */
 	SgExprStatement *assignGroupSizeStmt = 
-		BuildGroupSizeAssign(adios_groupsize_str);
+		BuildGroupSizeAssign(adios_groupsize_str, statsGroup);
+	batch.InsertAfter(adios_totalsize_decl, assignGroupSizeStmt);
+	return assignGroupSizeStmt;
+}
+
+
+/************************************************
+ * Insert adios_open and adios_group_size of one
+ * adios group after prevStmt. Fused: the size
+ * and dims of every group of the file.
+ * Input:
+ *		string suffix: suffix of the size vars
+ *		bool statsGroup: the stats group or not
+ *		int seq: the dims declared before this
+ *			call are written
+ * Return:
+ *		SgStatement *: last inserted statement
+ ************************************************/
+SgStatement *
+Group::InsertAdOpen(SgStatement *prevStmt, const string &fileVar,
+	const string &name, const string &fileName, const string &suffix,
+	bool statsGroup, int seq, StmtBatch &batch)
+{
+	/***** adios_open(&fileVar, name, fileName, "w", CommExp) *****/
+	SgExprStatement *adOpenCall= BuildAdOpen(fileVar, name, fileName);
+	batch.InsertAfter(prevStmt, adOpenCall);
 
+	char groupIDStr[30];
+	snprintf(groupIDStr, 30, "%d", GroupID); 
+	string adios_groupsize_str =
+		string("adios_groupsize") + groupIDStr + suffix;
+	string adios_totalsize_str = 
+		string("adios_totalsize") + groupIDStr + suffix;
+
+	prevStmt = InsertGroupSize(adOpenCall, suffix, statsGroup, batch);
+
+	/***** Fused: adios_groupsizeXX += adios_groupsizeYY *****/
+	for (vector<Group*>::size_type i = 0; i < FusedVec.size(); ++i) {
+		if (FusedVec[i] == this)
+			continue;
+		snprintf(groupIDStr, 30, "%d", FusedVec[i]->GroupID); 
+		SgExprStatement *addStmt = buildExprStatement(
+			buildPlusAssignOp(buildVarRefExp(SgName(adios_groupsize_str)),
+				buildVarRefExp(SgName(string("adios_groupsize") + 
+					groupIDStr))));
+		batch.InsertAfter(prevStmt, addStmt);
+		prevStmt = addStmt;
+	}
 
-	/* adios_group_size(FileVar, adios_groupsize_str, 
+	/* adios_group_size(fileVar, adios_groupsize_str, 
 	 *	&adios_totalsize_str
 	 */
-	 SgExprStatement *adGroupSizeStmt = 
-	 	BuildAdGroupSize(adios_groupsize_str, adios_totalsize_str);
+	SgExprStatement *adGroupSizeStmt = 
+		BuildAdGroupSize(fileVar, adios_groupsize_str, adios_totalsize_str);
+	batch.InsertAfter(prevStmt, adGroupSizeStmt);
+
+	/***** adios_write(fileVar, dim, &dim) *****/
+	prevStmt = InsertDimWrites(adGroupSizeStmt, fileVar, -1, seq, batch);
+	for (vector<Group*>::size_type i = 0; i < FusedVec.size(); ++i) {
+		Group *g = FusedVec[i];
+		if (g != this)
+			prevStmt = g->InsertDimWrites(prevStmt, fileVar, -1, 
+				g->GetSeq(g->CallVV[NC_ENDDEF][0]), batch);
+	}
+	return prevStmt;
+}
+
+
+/************************************************
+ * Source order of a call of the group
+ ************************************************/
+int
+Group::GetSeq(SgFunctionCallExp *callExp) const
+{
+	map<SgFunctionCallExp*, int>::const_iterator itr = 
+		CallSeq.find(callExp);
+	assert(itr != CallSeq.end());
+	return itr->second;
+}
+
+
+/************************************************
+ * Dims declared by calls between low and high
+ * (exclusive) in source order
+ ************************************************/
+vector<string>
+Group::GetDimsBetween(int low, int high) const
+{
+	vector<string> allVec = GetAllDims(), vec;
+
+	for (vector<string>::size_type i = 0; i < allVec.size(); ++i) {
+		map<string, int>::const_iterator itr = DimSeq.find(allVec[i]);
+		int seq = (itr == DimSeq.end()) ? -1 : itr->second;
+		if (seq > low && seq < high)
+			vec.push_back(allVec[i]);
+	}
+	return vec;
+}
+
+
+/************************************************
+ * Insert adios_write(fileVar, dim, &dim) of the
+ * dims declared between low and high
+ * Return:
+ *		SgStatement *: last inserted statement,
+ *			prevStmt if none
+ ************************************************/
+SgStatement *
+Group::InsertDimWrites(SgStatement *prevStmt, const string &fileVar, 
+	int low, int high, StmtBatch &batch)
+{
+	vector<string> dimVec = GetDimsBetween(low, high);
+
+	for (vector<string>::iterator itr = dimVec.begin(); 
+			itr != dimVec.end(); ++itr) {
+		SgExprStatement *writeDim = BuildAdWrite(fileVar, *itr,
+			buildAddressOfOp(buildVarRefExp(SgName(*itr))));
+		batch.InsertAfter(prevStmt, writeDim);
+		prevStmt = writeDim;
+	}
+	return prevStmt;
+}
+
+
+
+/************************************************
+ * nc_put_vara_int(ncid, varid, startp, countp, op)
+ * becomes
+ *		{
+ *			unsigned int adios_c[ndims], adios_o[ndims];
+ *			adios_c[i] = countp[i]; adios_o[i] = startp[i];
+ *			adios_write(adios_fileXX, "c<dim>", &adios_c[i]);
+ *			adios_write(adios_fileXX, "o<dim>", &adios_o[i]);
+ *			nc2adios_analyze(...);		(profile analysis)
+ *			adios_write(adios_fileXX, name, op);
+ *		}
+ * Each iteration writes one more block of the var
+ * In an OpenMP parallel region the threads pack
+ * their tiles instead
+ *		static nc2adios_omp_buf adios_ompXX;
+ *		nc2adios_omp_begin(&adios_ompXX,
+ *			omp_get_max_threads(), ndims, sizeof(int));
+ *		#pragma omp parallel ...
+ *			nc2adios_omp_pack(&adios_ompXX,
+ *				omp_get_thread_num(), startp, countp, op);
+ * and the block above, after the region, writes
+ * the block they cover
+ *			size_t adios_ostart[ndims], adios_ocount[ndims];
+ *			void *adios_odata = nc2adios_omp_end(
+ *				&adios_ompXX, adios_ostart, adios_ocount);
+ ************************************************/
+void
+Group::Process_nc_put_vara_int()
+{
+	assert(CallVV[NC_PUT_VARA_INT].size() == 1);
+	SgFunctionCallExp *callExp = CallVV[NC_PUT_VARA_INT][0];
+	vector<SgExpression*> args = GetCallArgs(callExp);
+
+	SgStatement *orginStmt = getEnclosingStatement(callExp);
+	SgStatement *region = GetOmpRegion(orginStmt);
+	SgScopeStatement *scope = getScope(region != NULL ? region : orginStmt);
+	pushScopeStack(scope);
+
+	map<SgInitializedName*, VarSec>::iterator itr 
+		= VarMap.find(ArgVarRef_InitName(args[1]));
+	assert(itr != VarMap.end());
+	const VarSec &var = itr->second;
+	vector<string> strVec = var.GetDimVec();
+	string fileVar = GetVarFileVar(var);
+	int ndims = strVec.size();
+	bool reduce = (var.Stride > 1 || var.MemTypeStr != var.TypeStr);
+
+	SgBasicBlock *block = buildBasicBlock();
+
+	if (region != NULL) {
+		args = InsertOmpPack(orginStmt, region, ndims, block);
+		orginStmt = region;
+	}
 
+	/***** unsigned int adios_c[ndims], adios_o[ndims] *****/
+	appendStatement(
+		buildVariableDeclaration("adios_c", 
+			buildArrayType(buildUnsignedIntType(), buildIntVal(ndims))),
+		block);
+	appendStatement(
+		buildVariableDeclaration("adios_o", 
+			buildArrayType(buildUnsignedIntType(), buildIntVal(ndims))),
+		block);
+
+	/***** Rollover: next piece before this put *****/
+	if (HasRollover())
+		appendStatement(BuildRollover(GetSeq(callExp)), block);
+
+	for (int i = 0; i < ndims && !reduce; ++i) {
+		appendStatement(
+			buildExprStatement(buildAssignOp(
+				buildPntrArrRefExp(buildVarRefExp(SgName("adios_c")), 
+					buildIntVal(i)),
+				buildPntrArrRefExp(copyExpression(args[3]), buildIntVal(i)))),
+			block);
+		appendStatement(
+			buildExprStatement(buildAssignOp(
+				buildPntrArrRefExp(buildVarRefExp(SgName("adios_o")), 
+					buildIntVal(i)),
+				buildPntrArrRefExp(copyExpression(args[2]), buildIntVal(i)))),
+			block);
+	}
+
+	/***** Reduction stage: decimate and downcast into
+			the runtime staging buffer, which fills the
+			reduced offsets and counts
+			void *adios_buf = nc2adios_reduce(op, memType, 
+				type, ndims, startp, countp, stride,
+				adios_o, adios_c) *****/
+	if (reduce) {
+		InsertRuntimeHeader(orginStmt);
+		SgExprListExp *argList = buildExprListExp();
+		appendExpression(argList, copyExpression(args[4]));
+		appendExpression(argList, 
+			buildVarRefExp(SgName(GetRtTypeMacro(var.MemTypeStr))));
+		appendExpression(argList, 
+			buildVarRefExp(SgName(GetRtTypeMacro(var.TypeStr))));
+		appendExpression(argList, buildIntVal(ndims));
+		appendExpression(argList, copyExpression(args[2]));
+		appendExpression(argList, copyExpression(args[3]));
+		appendExpression(argList, buildIntVal(var.Stride));
+		appendExpression(argList, buildVarRefExp(SgName("adios_o")));
+		appendExpression(argList, buildVarRefExp(SgName("adios_c")));
+		appendStatement(
+			buildVariableDeclaration("adios_buf", 
+				buildPointerType(buildVoidType()),
+				buildAssignInitializer(
+					buildFunctionCallExp(SgName("nc2adios_reduce"),
+						buildPointerType(buildVoidType()), argList))),
+			block);
+	}
+
+	/***** Count and offset vars *****/
+	for (int i = 0; i < ndims; ++i)
+		appendStatement(
+			BuildAdWrite(fileVar, "c"+strVec[i], 
+				buildAddressOfOp(buildPntrArrRefExp(
+					buildVarRefExp(SgName("adios_c")), buildIntVal(i)))),
+			block);
+	for (int i = 0; i < ndims; ++i)
+		appendStatement(
+			BuildAdWrite(fileVar, "o"+strVec[i], 
+				buildAddressOfOp(buildPntrArrRefExp(
+					buildVarRefExp(SgName("adios_o")), buildIntVal(i)))),
+			block);
+
+	/***** In-situ analysis on the buffer, 
+			right before it is written *****/
+	if (var.Analyze) {
+		InsertRuntimeHeader(orginStmt);
+		appendStatement(BuildAnalyze(var, fileVar, args), block);
+	}
+
+	appendStatement(BuildAdWrite(fileVar, var.Name, reduce ? 
+			buildVarRefExp(SgName("adios_buf")) : copyExpression(args[4])),
+		block);
+
+	/***** Rollover: adios_bytesXX += adios_c[0]*...*unitSize *****/
+	if (RolloverMB > 0) {
+		SgExpression *bytes = buildIntVal(var.UnitSize);
+		for (int i = 0; i < ndims; ++i)
+			bytes = buildMultiplyOp(bytes, 
+				buildPntrArrRefExp(buildVarRefExp(SgName("adios_c")), 
+					buildIntVal(i)));
+		appendStatement(
+			buildExprStatement(
+				buildPlusAssignOp(buildVarRefExp(SgName(BytesVar)), bytes)),
+			block);
+	}
+
+	if (region != NULL)
+		insertStatementAfter(region, block);
+	else
+		replaceStatement(orginStmt, block);
+	popScopeStack();
+}
+
+
+/************************************************
+ * Threads of an OpenMP region pack their tiles
+ * into a per-rank buffer: the buffer and its
+ * nc2adios_omp_begin before the region, the put
+ * becomes nc2adios_omp_pack, and block starts
+ * with nc2adios_omp_end
+ * Return:
+ *		vector<SgExpression*>: the put args with
+ *			the assembled block as startp, countp
+ *			and op, for the writes after the region
+ ************************************************/
+vector<SgExpression*>
+Group::InsertOmpPack(SgStatement *orginStmt, SgStatement *region, 
+	int ndims, SgBasicBlock *block)
+{
+	SgFunctionCallExp *callExp = CallVV[NC_PUT_VARA_INT][0];
+	vector<SgExpression*> args = GetCallArgs(callExp);
+	SgScopeStatement *scope = getScope(region);
+	char groupIDStr[30];
+	snprintf(groupIDStr, 30, "%d", GroupID); 
+	string bufVar = string("adios_omp") + groupIDStr;
+
+	InsertRuntimeHeader(orginStmt);
+	InsertOmpHeader(orginStmt);
+
+	/***** static nc2adios_omp_buf adios_ompXX;
+			nc2adios_omp_begin(...) *****/
+	SgStatement *pragma = getPreviousStatement(region, false);
+	SgVariableDeclaration *bufDecl = buildVariableDeclaration(bufVar,
+		buildOpaqueType("nc2adios_omp_buf", scope), NULL, scope);
+	setStatic(bufDecl);
+	SgExprListExp *argList = buildExprListExp();
+	/***** A slot per thread of the team: its
+			num_threads(N), else the default
+			omp_get_max_threads() *****/
+	string numThreads = GetOmpNumThreads(region);
+	appendExpression(argList, buildAddressOfOp(buildVarRefExp(SgName(bufVar))));
+	if (!numThreads.empty())
+		appendExpression(argList, 
+			buildOpaqueVarRefExp("(" + numThreads + ")", scope));
+	else
+		appendExpression(argList, buildFunctionCallExp(
+			SgName("omp_get_max_threads"), buildIntType(), buildExprListExp()));
+	appendExpression(argList, buildIntVal(ndims));
+	appendExpression(argList, buildSizeOfOp(buildIntType()));
+	insertStatementBefore(pragma, bufDecl);
+	insertStatementBefore(pragma, 
+		buildFunctionCallStmt(SgName("nc2adios_omp_begin"), 
+			buildVoidType(), argList, scope));
+
+	/***** nc2adios_omp_pack(&adios_ompXX, 
+			omp_get_thread_num(), startp, countp, op) *****/
+	pushScopeStack(getScope(orginStmt));
+	argList = buildExprListExp();
+	appendExpression(argList, buildAddressOfOp(buildVarRefExp(SgName(bufVar))));
+	appendExpression(argList, buildFunctionCallExp(
+		SgName("omp_get_thread_num"), buildIntType(), buildExprListExp()));
+	appendExpression(argList, copyExpression(args[2]));
+	appendExpression(argList, copyExpression(args[3]));
+	appendExpression(argList, copyExpression(args[4]));
+	replaceStatement(orginStmt, 
+		buildFunctionCallStmt(SgName("nc2adios_omp_pack"), 
+			buildVoidType(), argList));
+	popScopeStack();
+
+	/***** The assembled block *****/
+	SgType *sizeType = buildOpaqueType("size_t", scope);
+	appendStatement(
+		buildVariableDeclaration("adios_ostart", 
+			buildArrayType(sizeType, buildIntVal(ndims))),
+		block);
+	appendStatement(
+		buildVariableDeclaration("adios_ocount", 
+			buildArrayType(sizeType, buildIntVal(ndims))),
+		block);
+	argList = buildExprListExp();
+	appendExpression(argList, buildAddressOfOp(buildVarRefExp(SgName(bufVar))));
+	appendExpression(argList, buildVarRefExp(SgName("adios_ostart")));
+	appendExpression(argList, buildVarRefExp(SgName("adios_ocount")));
+	appendStatement(
+		buildVariableDeclaration("adios_odata", 
+			buildPointerType(buildVoidType()),
+			buildAssignInitializer(
+				buildFunctionCallExp(SgName("nc2adios_omp_end"),
+					buildPointerType(buildVoidType()), argList))),
+		block);
+
+	args[2] = buildVarRefExp(SgName("adios_ostart"));
+	args[3] = buildVarRefExp(SgName("adios_ocount"));
+	args[4] = buildVarRefExp(SgName("adios_odata"));
+	return args;
+}
+
+
+/************************************************
+ * File name of an adios_open: the name itself,
+ * or with rollover its current piece
+ *		nc2adios_piece(fileName, adios_pieceXX,
+ *			manifest, comm)
+ * list: a new piece, list it in the manifest
+ ************************************************/
+SgExpression *
+Group::BuildFileNameExp(const string &fileName, bool list)
+{
+	if (!HasRollover())
+		return buildStringVal(fileName);
+
+	InsertRuntimeHeader(getEnclosingStatement(CallVV[NC_ENDDEF][0]));
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, buildStringVal(fileName));
+	appendExpression(argList, buildVarRefExp(SgName(PieceVar)));
+	appendExpression(argList, buildIntVal(RolloverManifest && list));
+	appendExpression(argList, (CommExp != NULL) ? 
+		copyExpression(CommExp) : buildVarRefExp(SgName("comm")));
+
+	return buildFunctionCallExp(SgName("nc2adios_piece"),
+		buildPointerType(buildCharType()), argList);
+}
+
+
+/************************************************
+ * Name adios_open writes to: with staging the
+ * file of the same base name in the stage dir
+ *		nc2adios_stage_path(fileName, dir)
+ ************************************************/
+SgExpression *
+Group::BuildOpenNameExp(const string &fileName, bool list)
+{
+	SgExpression *nameExp = BuildFileNameExp(fileName, list);
+	if (!IsStaged())
+		return nameExp;
+
+	InsertRuntimeHeader(getEnclosingStatement(CallVV[NC_ENDDEF][0]));
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, nameExp);
+	appendExpression(argList, buildStringVal(GetStageDir()));
+
+	return buildFunctionCallExp(SgName("nc2adios_stage_path"),
+		buildPointerType(buildCharType()), argList);
+}
+
+
+/************************************************
+ * adios_close(adios_fileXX); and with staging
+ *		nc2adios_stage_drain(fileName, dir, keep,
+ *			comm);
+ *		(nc2adios_stage_wait();)
+ * which hands the closed file to the drain
+ * thread. keep: copy only, the file is opened
+ * again for append, so wait for the copy first:
+ * an append during it would tear the copy.
+ ************************************************/
+void
+Group::AppendAdClose(SgBasicBlock *block, const string &fileVar,
+	const string &fileName, bool keep)
+{
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, buildVarRefExp(SgName(fileVar)));
+	appendStatement(
+		buildFunctionCallStmt(SgName("adios_close"), buildIntType(), argList),
+		block);
+	if (!IsStaged())
+		return;
+	appendStatement(BuildStageDrain(fileName, keep), block);
+	if (keep)
+		appendStatement(
+			buildFunctionCallStmt(SgName("nc2adios_stage_wait"),
+				buildVoidType(), buildExprListExp()),
+			block);
+}
+
+
+SgExprStatement *
+Group::BuildStageDrain(const string &fileName, bool keep)
+{
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, BuildFileNameExp(fileName, false));
+	appendExpression(argList, buildStringVal(GetStageDir()));
+	appendExpression(argList, buildIntVal(keep));
+	appendExpression(argList, (CommExp != NULL) ? 
+		copyExpression(CommExp) : buildVarRefExp(SgName("comm")));
+
+	return buildFunctionCallStmt(SgName("nc2adios_stage_drain"),
+		buildVoidType(), argList);
+}
+
+
+/************************************************
+ * Before a put:
+ *		if (adios_stepXX == N || adios_bytesXX >= MB) {
+ *			adios_close(adios_fileXX);
+ *			(nc2adios_stage_drain(...);)
+ *			(and the same for the stats file)
+ *			adios_stepXX = 0; adios_bytesXX = 0;
+ *			adios_pieceXX++;
+ *			adios_open(...), adios_group_size(...),
+ *			adios_write of the dims
+ *		}
+ *		adios_stepXX++;
+ * The group size of the whole run bounds that
+ * of each piece.
+ ************************************************/
+SgStatement *
+Group::BuildRollover(int seq)
+{
+	SgExpression *cond = NULL;
+	if (RolloverSteps > 0)
+		cond = buildEqualityOp(buildVarRefExp(SgName(StepVar)),
+			buildIntVal(RolloverSteps));
+	if (RolloverMB > 0) {
+		SgExpression *sizeCond = 
+			buildGreaterOrEqualOp(buildVarRefExp(SgName(BytesVar)),
+				buildMultiplyOp(buildUnsignedLongLongIntVal(RolloverMB), 
+					buildUnsignedLongLongIntVal(1048576)));
+		cond = (cond == NULL) ? sizeCond : buildOrOp(cond, sizeCond);
+	}
+
+	SgBasicBlock *body = buildBasicBlock();
+	AppendAdClose(body, FileVar, FileName, false);
+	if (HasStatsGroup)
+		AppendAdClose(body, StatsFileVar, StatsFileName, false);
+	appendStatement(
+		buildExprStatement(buildAssignOp(
+			buildVarRefExp(SgName(StepVar)), buildIntVal(0))),
+		body);
+	appendStatement(
+		buildExprStatement(buildAssignOp(
+			buildVarRefExp(SgName(BytesVar)), 
+			buildUnsignedLongLongIntVal(0))),
+		body);
+	appendStatement(
+		buildExprStatement(
+			buildPlusPlusOp(buildVarRefExp(SgName(PieceVar)))),
+		body);
+	AppendAdOpen(body, FileVar, Name, FileName, "", "w", seq);
+	if (HasStatsGroup)
+		AppendAdOpen(body, StatsFileVar, StatsName, StatsFileName, 
+			"_stats", "w", seq);
+
+	SgBasicBlock *block = buildBasicBlock();
+	appendStatement(buildIfStmt(cond, body, NULL), 
+		block);
+	appendStatement(
+		buildExprStatement(
+			buildPlusPlusOp(buildVarRefExp(SgName(StepVar)))),
+		block);
+	return block;
+}
+
+
+/************************************************
+ * Open a closed file again, mode "w" for its 
+ * next piece, "a" for its next step, with the
+ * group size computed at nc_enddef and the dims
+ * declared before the call at seq
+ ************************************************/
+void
+Group::AppendAdOpen(SgBasicBlock *block, const string &fileVar,
+	const string &name, const string &fileName, const string &suffix,
+	const string &mode, int seq)
+{
+	char groupIDStr[30];
+	snprintf(groupIDStr, 30, "%d", GroupID); 
+
+	appendStatement(BuildAdOpen(fileVar, name, fileName, mode), block);
+	appendStatement(
+		BuildAdGroupSize(fileVar, 
+			string("adios_groupsize") + groupIDStr + suffix,
+			string("adios_totalsize") + groupIDStr + suffix),
+		block);
+
+	vector<string> dimVec = GetDimsBetween(-1, seq);
+	for (vector<string>::iterator itr = dimVec.begin(); 
+			itr != dimVec.end(); ++itr)
+		appendStatement(
+			BuildAdWrite(fileVar, *itr, 
+				buildAddressOfOp(buildVarRefExp(SgName(*itr)))),
+			block);
+}
+
+
+/************************************************
+ * nc_close(ncid) of a written file becomes
+ *		adios_close(adios_fileXX);
+ *		(adios_close(adios_fileXX_stats);)
+ * each followed by its drain with staging
+ ************************************************/
+void
+Group::Process_nc_close()
+{
+	StmtBatch batch;
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_CLOSE];
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		SgStatement *orginStmt = getEnclosingStatement(vec[i]);
+
+		/***** Fused: the last nc_close closes the file *****/
+		if (Closer != NULL && Closer != this) {
+			batch.Remove(orginStmt);
+			continue;
+		}
+		pushScopeStack(getScope(orginStmt));
+
+		SgExprListExp *argList = buildExprListExp();
+		appendExpression(argList, buildVarRefExp(SgName(FileVar)));
+		SgStatement *lastStmt = 
+			buildFunctionCallStmt(SgName("adios_close"), 
+				buildIntType(), argList);
+		batch.InsertAfter(orginStmt, lastStmt);
+		if (IsStaged()) {
+			SgStatement *drainStmt = BuildStageDrain(GetFileName(), false);
+			batch.InsertAfter(lastStmt, drainStmt);
+			lastStmt = drainStmt;
+		}
+
+		if (HasStatsGroup) {
+			argList = buildExprListExp();
+			appendExpression(argList, buildVarRefExp(SgName(StatsFileVar)));
+			SgStatement *statsStmt = 
+				buildFunctionCallStmt(SgName("adios_close"), 
+					buildIntType(), argList);
+			batch.InsertAfter(lastStmt, statsStmt);
+			if (IsStaged())
+				batch.InsertAfter(statsStmt, 
+					BuildStageDrain(StatsFileName, false));
+		}
+
+		batch.Remove(orginStmt);
+		popScopeStack();
+	}
+	batch.Flush();
+}
 
-//	/***** Insert *****/
-	insertStatementAfter(orginStmt, adOpenCall);
-	insertStatementAfter(adOpenCall, adios_groupsize_decl);
-	insertStatementAfter(adios_groupsize_decl, adios_totalsize_decl);
-	insertStatementAfter(adios_totalsize_decl, assignGroupSizeStmt);
-	insertStatementAfter(assignGroupSizeStmt, adGroupSizeStmt);
 
+/************************************************
+ * nc_redef(ncid): ADIOS has no define mode, 
+ * vars defined later just get their own
+ * adios_define_var. Removed.
+ ************************************************/
+void
+Group::Process_nc_redef()
+{
+	StmtBatch batch;
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_REDEF];
 
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i)
+		batch.Remove(getEnclosingStatement(vec[i]));
+	batch.Flush();
+}
 
 
-	/***** remove original statement *****/
-	removeStatement(orginStmt);
+/************************************************
+ * nc_sync(ncid), per profile "sync step|drop":
+ *		step: end the ADIOS step and start the 
+ *			next one in the same file
+ *			{
+ *				adios_close(adios_fileXX);
+ *				(nc2adios_stage_drain(..., 1, comm);
+ *				nc2adios_stage_wait();)
+ *				adios_open(&adios_fileXX, ..., "a", comm);
+ *				adios_group_size(...); dims
+ *			}
+ *		drop (default): removed, data reaches
+ *			the file at adios_close anyway
+ ************************************************/
+void
+Group::Process_nc_sync()
+{
+	StmtBatch batch;
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_SYNC];
+	bool step = (Opts->Prof.GetStr("sync", "drop") == "step");
+
+	if (step && Leader != NULL && !vec.empty()) {
+		cout << "WARNING: nc_sync of fused group " << Name 
+			<< " dropped" << endl;
+		step = false;
+	}
 
-	popScopeStack();
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		SgStatement *orginStmt = getEnclosingStatement(vec[i]);
+		if (!step) {
+			batch.Remove(orginStmt);
+			continue;
+		}
 
+		pushScopeStack(getScope(orginStmt));
+		SgBasicBlock *block = buildBasicBlock();
+		AppendAdClose(block, FileVar, FileName, true);
+		AppendAdOpen(block, FileVar, Name, FileName, "", "a", 
+			GetSeq(vec[i]));
+		if (HasStatsGroup) {
+			AppendAdClose(block, StatsFileVar, StatsFileName, true);
+			AppendAdOpen(block, StatsFileVar, StatsName, StatsFileName,
+				"_stats", "a", GetSeq(vec[i]));
+		}
+		batch.Replace(orginStmt, block);
+		popScopeStack();
+	}
+	batch.Flush();
 }
 
 
+/************************************************
+ * nc_put_att_text(ncid, varid, name, len, text)
+ * becomes
+ *		adios_define_attribute(adios_groupXX, name,
+ *			var name or "" (NC_GLOBAL), adios_string,
+ *			text, "")
+ * The XML config can NOT hold a runtime value,
+ * there the attribute is dropped
+ ************************************************/
+void
+Group::Process_nc_put_att_text()
+{
+	StmtBatch batch;
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_PUT_ATT_TEXT];
 
-// void
-// Group::Process_nc_put_vara_int()
-// {
-// 	assert(CallVV[NC_PUT_VARA_INT].size() == 1);
-// 	SgFunctionCallExp *callExp = CallVV[NC_PUT_VARA_INT][0];
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		const vector<SgExpression*> &args = GetCallArgs(vec[i]);
+		SgStatement *orginStmt = getEnclosingStatement(vec[i]);
+		string nameVar, name = ArgCharPtr(args[2], nameVar);
+
+		if (!Opts->XmlFile.empty()) {
+			cout << "WARNING: attribute " << (name.empty() ? nameVar : name)
+				<< " dropped with an XML config" << endl;
+			batch.Remove(orginStmt);
+			continue;
+		}
 
-// 	SgStatement *orginStmt;
-// 	orginStmt = getEnclosingStatement(callExp);
-// 	SgScopeStatement *scope = getScope(orginStmt);
-// 	pushScopeStack(scope);
-	
-// 	SgExpression *varidExp, *startpExp, *countpExp, *opExp;
-// 	SgInitializedName *varidInitName;
+		/***** Attribute of a var, or global *****/
+		string path, groupVar = GroupIDVar;
+		if (args[1]->variantT() == V_SgVarRefExp) {
+			map<SgInitializedName*, VarSec>::iterator itr = 
+				VarMap.find(ArgVarRef_InitName(args[1]));
+			if (itr != VarMap.end()) {
+				path = itr->second.Name;
+				groupVar = GetVarGroupIDVar(itr->second);
+			}
+		}
 
-// 	/***** Extract info from arguments *****/
-// 	varidExp = GetCallArgs(callExp)[1];
-// 	startpExp = GetCallArgs(callExp)[2];
-// 	countpExp = GetCallArgs(callExp)[3];
-// 	opExp = GetCallArgs(callExp)[4];
+		pushScopeStack(getScope(orginStmt));
+		SgExprListExp *argList = buildExprListExp();
+		appendExpression(argList, buildVarRefExp(SgName(groupVar)));
+		appendExpression(argList, copyExpression(args[2]));
+		appendExpression(argList, buildStringVal(AdPath(path)));
+		appendExpression(argList, 
+			GetEnumExpr("ADIOS_DATATYPES", "adios_string"));
+		appendExpression(argList, copyExpression(args[4]));
+		appendExpression(argList, buildStringVal(""));
+		batch.Replace(orginStmt, 
+			buildFunctionCallStmt(SgName("adios_define_attribute"), 
+				buildIntType(), argList));
+		popScopeStack();
+	}
+	batch.Flush();
+}
 
 
-// 	varidInitName = ArgVarRef_InitName(varidExp);
-// 	map<SgInitializedName*, VarSec>::iterator itr 
-// 		= VarMap.find(varidInitName);
-// 	assert(itr != VarMap.end());
-// 	vector<string> strVec = itr->second.StrVec;
+/************************************************
+ * nc2adios_analyze(adios_fileXX, name, type, op,
+ *		ndims, startp, countp, comm, reductions)
+ ************************************************/
+SgExprStatement *
+Group::BuildAnalyze(const VarSec &var, const string &fileVar,
+	const vector<SgExpression*> &args)
+{
+	SgExpression *mask = buildIntVal(0);
+	for (vector<string>::size_type i = 0; i < var.Reductions.size(); ++i)
+		mask = buildBitOrOp(mask, 
+			buildVarRefExp(SgName(GetReductionMacro(var.Reductions[i]))));
 
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, buildVarRefExp(SgName(fileVar)));
+	appendExpression(argList, buildStringVal(AdPath(var.Name)));
+	appendExpression(argList, 
+		buildVarRefExp(SgName(GetRtTypeMacro(var.MemTypeStr))));
+	appendExpression(argList, copyExpression(args[4]));
+	appendExpression(argList, buildIntVal(var.StrVec.size()));
+	appendExpression(argList, copyExpression(args[2]));
+	appendExpression(argList, copyExpression(args[3]));
+	appendExpression(argList, copyExpression(CommExp));
+	appendExpression(argList, mask);
+
+	return buildFunctionCallStmt(SgName("nc2adios_analyze"), 
+		buildIntType(), argList);
+}
 
-// 	SgType *startpType = ArgVarRef_Type(startpExp);
-// 	SgType *countpType = ArgVarRef_Type(countpExp);
-// 	assert(getDimensionCount(startpType) == 1);
-// 	assert(getDimensionCount(countpType) == 1);
-// 	assert(startpType->variantT() == V_SgArrayType);
-// 	assert(countpType->variantT() == V_SgArrayType);
-// 	assert(getArrayElementCount(static_cast<SgArrayType*>(startpType))
-// 		== strVec.size());
-// 	assert(getArrayElementCount(static_cast<SgArrayType*>(countpType))
-// 		== strVec.size());
 
+/************************************************
+ * adios_write(fileVar, name, data), or with the
+ * var ID from adios_define_var (noxml)
+ *		adios_write_byid(fileVar, adios_idsXX[slot], data)
+ ************************************************/
+SgExprStatement *
+Group::BuildAdWrite(const string &fileVar, const string &name,
+	SgExpression *data)
+{
+	bool statsGroup = (fileVar == StatsFileVar);
+	const map<string, int> &idMap = statsGroup ? StatsIdMap : IdMap;
+	map<string, int>::const_iterator itr = idMap.find(name);
 
-// 	/***** For Statement *****/
-// 	assert(scope->variantT() = V_SgForStatement);
-// 	SgForStatement *forStmt = static_cast<SgForStatement*>(scope);
-// 	pushScopeStack(scope);
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, buildVarRefExp(SgName(fileVar)));
+	if (itr == idMap.end())
+		appendExpression(argList, buildStringVal(AdPath(name)));
+	else
+		appendExpression(argList, BuildIdRef(statsGroup, itr->second));
+	appendExpression(argList, data);
 
+	return buildFunctionCallStmt(
+		SgName(itr == idMap.end() ? "adios_write" : "adios_write_byid"), 
+		buildIntType(), argList);
+}
 
-// 	/***** Declare offset dims *****/
-// 	SgVariableDeclaration *adGDecl[strVec.size()];
-// 	for (vector<string>::size_type i = 0; i < strVec.size(); i++) {
-// 		adGDecl[i] = buildVariableDeclaration("g"+strVec[i],
-// 						buildUnsignedIntType()
-// 					)
-// 	}
 
-// 	/*****
+/************************************************
+ * Slots of the ADIOS var IDs of the group and
+ * of its stats group, in define order: the dims,
+ * then per var in nc_def_var order
+ *		global:		c<dim>..., o<dim>..., var
+ *		replicated:	var
+ * A name maps to its first slot, the var a 
+ * name-based adios_write would find. The 
+ * runtime var tables fill the same layout.
+ * noxml only, the XML config returns no IDs.
+ ************************************************/
+void
+Group::FillIds()
+{
+	if (!Opts->XmlFile.empty())
+		return;
+
+	vector<string> dimVec = GetAllDims();
+
+	for (int stats = 0; stats < (HasStatsGroup ? 2 : 1); ++stats) {
+		map<string, int> &idMap = stats ? StatsIdMap : IdMap;
+		int &num = stats ? StatsIdNum : IdNum;
+
+		num = 0;
+		for (vector<string>::size_type i = 0; i < dimVec.size(); ++i)
+			idMap.insert(make_pair(dimVec[i], num++));
+
+		const vector<SgFunctionCallExp*> &calls = CallVV[NC_DEF_VAR];
+		for (vector<SgFunctionCallExp*>::size_type i = 0; 
+				i < calls.size(); ++i) {
+			map<SgInitializedName*, VarSec>::iterator itr = 
+				VarMap.find(ArgIntPtr_InitName(GetCallArgs(calls[i])[5]));
+			assert(itr != VarMap.end());
+			VarSec &var = itr->second;
+			if (InStatsGroup(var) != (stats == 1))
+				continue;
+			vector<string> strVec = var.GetDimVec();
+			var.IdBase = num;
+			if (!var.IsReplicated) {
+				for (vector<string>::size_type j = 0; j < strVec.size(); ++j)
+					idMap.insert(make_pair("c" + strVec[j], num++));
+				for (vector<string>::size_type j = 0; j < strVec.size(); ++j)
+					idMap.insert(make_pair("o" + strVec[j], num++));
+			}
+			idMap.insert(make_pair(var.Name, num++));
+		}
+	}
+}
 
 
+string
+Group::GetIdsVar(bool statsGroup) const
+{
+	char groupIDStr[30];
+	snprintf(groupIDStr, 30, "%d", GroupID); 
+	return string("adios_ids") + groupIDStr + (statsGroup ? "_stats" : "");
+}
 
 
-// }
+/************************************************
+ * adios_idsXX[slot]
+ ************************************************/
+SgExpression *
+Group::BuildIdRef(bool statsGroup, int slot)
+{
+	return buildPntrArrRefExp(buildVarRefExp(SgName(GetIdsVar(statsGroup))),
+		buildIntVal(slot));
+}
 
 
 
+/************************************************
+ * nc2adios_init(xml or NULL, comm, buffer_mb):
+ * adios_init/adios_init_noxml and the buffer
+ * once per process, however many groups and
+ * files call it; adios_finalize runs in
+ * MPI_Finalize
+ ************************************************/
 SgExprStatement *
 Group::BuildAdInit()
 {
-	/***** adios_init_noxml(comm) *****/
-	SgExpression *argArg1;
+	SgExpression *commArg;
 	if (CommExp != NULL)
-		argArg1 = copyExpression(CommExp);
+		commArg = copyExpression(CommExp);
 	else
-		argArg1 = buildVarRefExp(SgName("comm"));
-
-	SgExprListExp *argArgList = buildExprListExp();
-	appendExpression(argArgList, argArg1);
-	
-	SgExprStatement *call = 
-		buildFunctionCallStmt(SgName("adios_init_noxml"), 
-			buildIntType(), argArgList);
-	return call;
-}
-
-SgExprStatement *
-Group::BuildAdAllocBuf()
-{
-	/***** adios_allocate_buffer(ADIOS_BUFFER_ALLOC_NOW, 10) *****/
-	SgExpression *arg1 =  
-			GetEnumExpr("ADIOS_BUFFER_ALLOC_WHEN", "ADIOS_BUFFER_ALLOC_NOW");
+		commArg = buildVarRefExp(SgName("comm"));
 
-	SgUnsignedLongLongIntVal *arg2 = 
-			buildUnsignedLongLongIntVal(10);
 	SgExprListExp *argList = buildExprListExp();
-	appendExpression(argList, arg1);
-	appendExpression(argList, arg2);
-	SgExprStatement *call = 
-		buildFunctionCallStmt(SgName("adios_allocate_buffer"),
+	if (!Opts->XmlFile.empty())
+		appendExpression(argList, buildStringVal(Opts->XmlFile));
+	else
+		appendExpression(argList, buildIntVal(0));
+	appendExpression(argList, commArg);
+	appendExpression(argList, buildUnsignedLongLongIntVal(GetBufferMB()));
+	
+	return buildFunctionCallStmt(SgName("nc2adios_init"), 
 			buildIntType(), argList);
-
-	return call;
 }
 
 SgExprStatement *
-Group::BuildAdDeclGroup()
+Group::BuildAdDeclGroup(const string &groupVar, const string &name,
+	bool stats)
 {
 
-	/***** adios_declare_group(&GroupIDVar, Name, 
-			"", adios_flag_yes) *****/
+	/***** adios_declare_group(&groupVar, name, 
+			"", adios_flag_yes/no) *****/
 	SgAddressOfOp *arg1 = 
-		buildAddressOfOp(buildVarRefExp(SgName(GroupIDVar)) );
-	SgStringVal *arg2 = buildStringVal(Name);
+		buildAddressOfOp(buildVarRefExp(SgName(groupVar)) );
+	SgStringVal *arg2 = buildStringVal(name);
 	SgStringVal *arg3 = buildStringVal("");
 	SgExpression *arg4 =  
-			GetEnumExpr("ADIOS_FLAG", "adios_flag_yes");
+			GetEnumExpr("ADIOS_FLAG", 
+				stats ? "adios_flag_yes" : "adios_flag_no");
 
 	SgExprListExp *argList = buildExprListExp();
 	appendExpression(argList, arg1);
@@ -800,12 +2529,12 @@ Group::BuildAdDeclGroup()
 }
 
 SgExprStatement *
-Group::BuildAdSelMod()
+Group::BuildAdSelMod(const string &groupVar)
 {
-	/***** 	adios_select_method (GroupIDVar, "MPI", "", "") *****/
-	SgVarRefExp *arg1 = buildVarRefExp(SgName(GroupIDVar));
-	SgStringVal *arg2 = buildStringVal("MPI");
-	SgStringVal *arg3 = buildStringVal("");
+	/***** 	adios_select_method (groupVar, method, params, "") *****/
+	SgVarRefExp *arg1 = buildVarRefExp(SgName(groupVar));
+	SgStringVal *arg2 = buildStringVal(GetMethod());
+	SgStringVal *arg3 = buildStringVal(GetMethodParams());
 	SgStringVal *arg4 = buildStringVal("");
 
 	SgExprListExp *argList = buildExprListExp();
@@ -822,19 +2551,20 @@ Group::BuildAdSelMod()
 }
 	
 SgExprStatement *
-Group::BuildAdDefVar(const string &varName, const string &typeName,
-	const string &count, const string &global, const string &offset)
+Group::BuildAdDefVar(const string &groupVar, const string &varName, 
+	const string &typeName, const string &count, const string &global, 
+	const string &offset, int slot)
 {
 	/***** Args *****/
 	SgExpression *arg1, *arg2, *arg3,
 			*arg4, *arg5, *arg6, *arg7;
-	arg1 = buildVarRefExp(GroupIDVar);
-	arg2 = buildStringVal(varName);
+	arg1 = buildVarRefExp(groupVar);
+	arg2 = buildStringVal(AdPath(varName));
 	arg3 = buildStringVal("");
 	arg4 = GetEnumExpr("ADIOS_DATATYPES", typeName);
-	arg5 = buildStringVal(count);
-	arg6 = buildStringVal(global);
-	arg7 = buildStringVal(offset);
+	arg5 = buildStringVal(AdPathList(count));
+	arg6 = buildStringVal(AdPathList(global));
+	arg7 = buildStringVal(AdPathList(offset));
 
 	/***** Arg list *****/
 	SgExprListExp *argList = buildExprListExp();
@@ -846,22 +2576,30 @@ Group::BuildAdDefVar(const string &varName, const string &typeName,
 	appendExpression(argList, arg6);
 	appendExpression(argList, arg7);
 
-	/***** Call *****/
-	SgExprStatement *call = 
-		buildFunctionCallStmt(SgName("adios_define_var"),
+	/***** Call, keeping the var ID in its slot:
+			adios_idsXX[slot] = adios_define_var(...) *****/
+	if (slot < 0)
+		return buildFunctionCallStmt(SgName("adios_define_var"),
 			buildLongLongType(), argList);
 
-	return call;
+	return buildExprStatement(
+		buildAssignOp(
+			BuildIdRef(groupVar == StatsGroupIDVar, slot),
+			buildFunctionCallExp(SgName("adios_define_var"),
+				buildLongLongType(), argList)
+		)
+	);
 }
 
 SgExprStatement *
-Group::BuildAdOpen()
+Group::BuildAdOpen(const string &fileVar, const string &name, 
+	const string &fileName, const string &mode)
 {
 	SgExpression *arg1 = 
-		buildAddressOfOp(buildVarRefExp(SgName(FileVar)) );
-	SgExpression *arg2 = buildStringVal(Name);
-	SgExpression *arg3 = buildStringVal(FileName);
-	SgExpression *arg4 = buildStringVal("w");
+		buildAddressOfOp(buildVarRefExp(SgName(fileVar)) );
+	SgExpression *arg2 = buildStringVal(name);
+	SgExpression *arg3 = BuildOpenNameExp(fileName, mode == "w");
+	SgExpression *arg4 = buildStringVal(mode);
 	SgExpression *arg5;
 	if (CommExp != NULL)
 		arg5 = copyExpression(CommExp);
@@ -884,7 +2622,7 @@ Group::BuildAdOpen()
 
 
 void
-Group::InsertAdiosInit()
+Group::InsertAdiosInit(StmtBatch &batch)
 {
 	SgStatement *orginStmt;
 
@@ -898,39 +2636,131 @@ Group::InsertAdiosInit()
 
 //	SgTypedefDeclaration *decl = Get_MPI_Comm_Declaration();
 
-	/***** long long adios_groupXX *****/
-	SgVariableDeclaration *adios_group_VarDecl = 
-		buildVariableDeclaration(GroupIDVar, buildLongLongType());
+	InsertAdiosHeader(orginStmt);
+	InsertRuntimeHeader(orginStmt);
+	FillIds();
+
+	/***** int adios_rankXX; MPI_Comm_rank(comm, &adios_rankXX)
+			for vars only rank 0 writes, and reductions *****/
+	if (HasReplicated() || HasReductions()) {
+		SgVariableDeclaration *rankDecl = 
+			buildVariableDeclaration(RankVar, buildIntType());
+		SgExprListExp *argList = buildExprListExp();
+		appendExpression(argList, (CommExp != NULL) ? 
+			copyExpression(CommExp) : buildVarRefExp(SgName("comm")));
+		appendExpression(argList, 
+			buildAddressOfOp(buildVarRefExp(SgName(RankVar))));
+		SgExprStatement *rankCall = 
+			buildFunctionCallStmt(SgName("MPI_Comm_rank"), 
+				buildIntType(), argList);
+
+		batch.InsertAfter(orginStmt, rankDecl);
+		batch.InsertAfter(rankDecl, rankCall);
+	}
+
+	/***** Rollover state:
+			int adios_stepXX = 0, adios_pieceXX = 0;
+			unsigned long long adios_bytesXX = 0; *****/
+	if (HasRollover()) {
+		batch.InsertAfter(orginStmt, 
+			buildVariableDeclaration(BytesVar, buildUnsignedLongLongType(),
+				buildAssignInitializer(buildUnsignedLongLongIntVal(0))));
+		batch.InsertAfter(orginStmt, 
+			buildVariableDeclaration(PieceVar, buildIntType(),
+				buildAssignInitializer(buildIntVal(0))));
+		batch.InsertAfter(orginStmt, 
+			buildVariableDeclaration(StepVar, buildIntType(),
+				buildAssignInitializer(buildIntVal(0))));
+	}
+
+	/***** Fused, not the leader: the leader declares
+			the adios group and file, only the var IDs
+			are this group's *****/
+	if (Leader != NULL && Leader != this) {
+		if (Opts->XmlFile.empty())
+			batch.InsertAfter(orginStmt,
+				buildVariableDeclaration(GetIdsVar(false), 
+					buildArrayType(buildOpaqueType("int64_t", scope), 
+						buildIntVal(IdNum))));
+		batch.Remove(orginStmt);
+		popScopeStack();
+		return;
+	}
 
 	/***** long long adios_fileXX *****/
 	SgVariableDeclaration *adios_file_VarDecl = 
 		buildVariableDeclaration(FileVar, buildLongLongType());
 
-
 	SgExprStatement *adInitCall	= BuildAdInit();
-	SgExprStatement *adAllocBufCall = BuildAdAllocBuf();
-	SgExprStatement *adDeclGroupCall = BuildAdDeclGroup();
-	SgExprStatement *adSelModCall = BuildAdSelMod();
 
-	/***** Insert adios code *****/
-	insertStatementAfter(orginStmt, adios_group_VarDecl);
-	insertStatementAfter(adios_group_VarDecl, adios_file_VarDecl);
+	/***** XML config: the group, its vars, method 
+			and buffer are all defined there *****/
+	if (!Opts->XmlFile.empty()) {
+		batch.InsertAfter(orginStmt, adios_file_VarDecl);
+		batch.InsertAfter(adios_file_VarDecl, adInitCall);
+		cout << "Inserting nc2adios_init" << endl;
+		if (HasStatsGroup)
+			batch.InsertAfter(adios_file_VarDecl,
+				buildVariableDeclaration(StatsFileVar, buildLongLongType()));
+		batch.Remove(orginStmt);
+		popScopeStack();
+		return;
+	}
+
+	/***** long long adios_groupXX *****/
+	SgVariableDeclaration *adios_group_VarDecl = 
+		buildVariableDeclaration(GroupIDVar, buildLongLongType());
+
+	SgExprStatement *adDeclGroupCall = 
+		BuildAdDeclGroup(GroupIDVar, Name, StatsOn);
+	SgExprStatement *adSelModCall = BuildAdSelMod(GroupIDVar);
 
-	insertStatementAfter(adios_file_VarDecl, adInitCall);
-	cout << "Inserting adios_init_noxml" << endl;
+	/***** int64_t adios_idsXX[n]: var IDs *****/
+	SgVariableDeclaration *adios_ids_VarDecl = 
+		buildVariableDeclaration(GetIdsVar(false), 
+			buildArrayType(buildOpaqueType("int64_t", scope), 
+				buildIntVal(IdNum)));
 
-	insertStatementAfter(adInitCall, adAllocBufCall);
-	cout << "Inserting adios_allocate_buffer" << endl;
+	/***** Insert adios code *****/
+	batch.InsertAfter(orginStmt, adios_group_VarDecl);
+	batch.InsertAfter(adios_group_VarDecl, adios_ids_VarDecl);
+	batch.InsertAfter(adios_ids_VarDecl, adios_file_VarDecl);
+
+	batch.InsertAfter(adios_file_VarDecl, adInitCall);
+	cout << "Inserting nc2adios_init" << endl;
 
-	insertStatementAfter(adAllocBufCall, adDeclGroupCall);
+	batch.InsertAfter(adInitCall, adDeclGroupCall);
 	cout << "Inserting adios_declare_group" << endl;
 
-	insertStatementAfter(adDeclGroupCall, adSelModCall);
+	batch.InsertAfter(adDeclGroupCall, adSelModCall);
 	cout << "Inserting adios_select_method" << endl;
 
+	/***** Stats group: declared with statistics on *****/
+	if (HasStatsGroup) {
+		SgVariableDeclaration *stats_group_VarDecl = 
+			buildVariableDeclaration(StatsGroupIDVar, buildLongLongType());
+		SgVariableDeclaration *stats_file_VarDecl = 
+			buildVariableDeclaration(StatsFileVar, buildLongLongType());
+		SgExprStatement *statsDeclGroupCall = 
+			BuildAdDeclGroup(StatsGroupIDVar, StatsName, true);
+		SgExprStatement *statsSelModCall = BuildAdSelMod(StatsGroupIDVar);
+
+		SgVariableDeclaration *stats_ids_VarDecl = 
+			buildVariableDeclaration(GetIdsVar(true), 
+				buildArrayType(buildOpaqueType("int64_t", scope), 
+					buildIntVal(StatsIdNum)));
+
+		batch.InsertAfter(adios_file_VarDecl, stats_group_VarDecl);
+		batch.InsertAfter(stats_group_VarDecl, stats_ids_VarDecl);
+		batch.InsertAfter(stats_ids_VarDecl, stats_file_VarDecl);
+		batch.InsertAfter(adSelModCall, statsDeclGroupCall);
+		batch.InsertAfter(statsDeclGroupCall, statsSelModCall);
+		cout << "Inserting stats group " << StatsName << endl;
+	}
+
 
 	/***** remove original statement *****/
-	removeStatement(orginStmt);
+	batch.Remove(orginStmt);
 
 
 	popScopeStack();
@@ -939,13 +2769,14 @@ Group::InsertAdiosInit()
 }
 
 SgExprStatement *
-Group::BuildGroupSizeAssign(const string &groupSizeVarName)
+Group::BuildGroupSizeAssign(const string &groupSizeVarName, 
+	bool statsGroup)
 {
 
 	/***** Build group size assign statement *****/
 	int ndims;
 	SgExpression *rhs = buildUnsignedLongLongIntVal(0);
-	SgExpression *countCal = buildUnsignedLongLongIntVal(1);
+	SgExpression *countCal;
 	SgExpression *dataSize;
 	SgName countVar;	
 
@@ -953,21 +2784,65 @@ Group::BuildGroupSizeAssign(const string &groupSizeVarName)
 	for (map<SgInitializedName*, VarSec>::iterator itr = VarMap.begin();
 			itr != VarMap.end(); ++itr) {
 
-		assert(itr->second.IsGlobal == true);
+		if (InStatsGroup(itr->second) != statsGroup)
+			continue;
 		ndims = itr->second.StrVec.size();
 		assert(ndims > 0);
+		countCal = buildUnsignedLongLongIntVal(1);
+
+		/* Replicated: every rank writes the dims,
+		 * only rank 0 the data
+		 * ndims*8 + (adios_rankXX == 0 ?
+		 *		dim0*...*UnitSize*IterNum : 0) */
+		if (itr->second.IsReplicated) {
+			for (vector<string>::size_type i = 0; i < ndims; i++)
+				countCal = buildMultiplyOp(countCal, 
+					buildVarRefExp(SgName(itr->second.StrVec[i])));
+			rhs = 
+				buildAddOp(
+					rhs,
+					buildAddOp(
+						buildMultiplyOp(
+							buildIntVal(ndims),
+							buildIntVal(8)
+						),
+						buildConditionalExp(
+							buildEqualityOp(buildVarRefExp(SgName(RankVar)),
+								buildIntVal(0)),
+							buildMultiplyOp(
+								buildMultiplyOp(
+									countCal,
+									buildIntVal(itr->second.UnitSize)
+								),
+								buildIntVal(itr->second.IterNum)
+							),
+							buildUnsignedLongLongIntVal(0)
+						)
+					)
+				);
+			continue;
+		}
+
+		assert(itr->second.IsGlobal == true);
 		countVar = itr->second.CountInit->get_name();
 
+		/***** Decimated: at most (count + D - 1) / D 
+				elements along each dim *****/
 		for (vector<string>::size_type i = 0;
 				i < ndims; i++) {
-			countCal = 
-				buildMultiplyOp(
-					countCal, 
-					buildPntrArrRefExp(
-						buildVarRefExp(countVar),
-						buildIntVal(i)
-					)
+			SgExpression *count = 
+				buildPntrArrRefExp(
+					buildVarRefExp(countVar),
+					buildIntVal(i)
 				);
+			if (itr->second.Stride > 1)
+				count = 
+					buildDivideOp(
+						buildAddOp(count, 
+							buildIntVal(itr->second.Stride - 1)),
+						buildIntVal(itr->second.Stride)
+					);
+			countCal = buildMultiplyOp(countCal, count);
 		}
 
 	 	dataSize = 
@@ -991,8 +2866,11 @@ Group::BuildGroupSizeAssign(const string &groupSizeVarName)
 								buildIntVal(8)
 							),
 							buildMultiplyOp(
-								buildIntVal(ndims),
-								buildIntVal(4)
+								buildMultiplyOp(
+									buildIntVal(ndims),
+									buildIntVal(4)
+								),
+								buildIntVal(itr->second.IterNum)
 							)
 						),
 						buildMultiplyOp(
@@ -1006,6 +2884,20 @@ Group::BuildGroupSizeAssign(const string &groupSizeVarName)
 					dataSize
 				)
 			);
+
+		/***** Reductions, rank 0 only: 8 bytes each *****/
+		if (!itr->second.Reductions.empty())
+			rhs = 
+				buildAddOp(
+					rhs,
+					buildConditionalExp(
+						buildEqualityOp(buildVarRefExp(SgName(RankVar)),
+							buildIntVal(0)),
+						buildIntVal(itr->second.Reductions.size() * 8 * 
+							itr->second.IterNum),
+						buildIntVal(0)
+					)
+				);
 	}
 
 	SgExprStatement *groupSizeAssignStmt = 
@@ -1022,12 +2914,218 @@ Group::BuildGroupSizeAssign(const string &groupSizeVarName)
 }
 
 
+/************************************************
+ * Vars of the group or of its stats group,
+ * in nc_def_var order
+ ************************************************/
+vector<const VarSec*>
+Group::GetVarOrder(bool statsGroup) const
+{
+	vector<const VarSec*> vec;
+	const vector<SgFunctionCallExp*> &calls = CallVV[NC_DEF_VAR];
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i < calls.size(); ++i) {
+		map<SgInitializedName*, VarSec>::const_iterator itr = 
+			VarMap.find(ArgIntPtr_InitName(GetCallArgs(calls[i])[5]));
+		assert(itr != VarMap.end());
+		if (InStatsGroup(itr->second) == statsGroup)
+			vec.push_back(&itr->second);
+	}
+	return vec;
+}
+
+
+/************************************************
+ * All dims written to the group's files,
+ * decimated ones included
+ ************************************************/
+vector<string>
+Group::GetAllDims() const
+{
+	set<string> dimSet;
+
+	for (map<SgInitializedName*, vector<string> >::const_iterator 
+			itr = DimMap.begin(); itr != DimMap.end(); ++itr)
+		dimSet.insert(itr->second.begin(), itr->second.end());
+	for (map<SgInitializedName*, VarSec>::const_iterator
+			itr = VarMap.begin(); itr != VarMap.end(); ++itr)
+		if (itr->second.Stride > 1) {
+			vector<string> dimVec = itr->second.GetDimVec();
+			dimSet.insert(dimVec.begin(), dimVec.end());
+		}
+	return vector<string>(dimSet.begin(), dimSet.end());
+}
+
+
+string
+Group::GetVarTableVar(const string &suffix) const
+{
+	char groupIDStr[30];
+	snprintf(groupIDStr, 30, "%d", GroupID); 
+	return string("adios_vars") + groupIDStr + suffix;
+}
+
+
+/************************************************
+ * Descriptor table of a group, the dims first:
+ * static const nc2adios_var_desc adios_varsXX[] = {
+ *		{name, type, kind, ndims, "dims", 
+ *			unitSize, iterNum, stride, "reductions"},
+ *		...
+ * };
+ ************************************************/
+SgVariableDeclaration *
+Group::BuildVarTable(const string &suffix, bool statsGroup)
+{
+	SgScopeStatement *scope = topScopeStack();
+	vector<string> dimVec = GetAllDims();
+	vector<const VarSec*> varVec = GetVarOrder(statsGroup);
+	SgExprListExp *rows = buildExprListExp();
+
+	for (vector<string>::size_type i = 0; i < dimVec.size(); ++i) {
+		SgExprListExp *row = buildExprListExp();
+		appendExpression(row, buildStringVal(AdPath(dimVec[i])));
+		appendExpression(row, 
+			GetEnumExpr("ADIOS_DATATYPES", "adios_unsigned_long"));
+		appendExpression(row, buildVarRefExp(SgName("NC2ADIOS_DESC_DIM")));
+		appendExpression(row, buildIntVal(0));
+		appendExpression(row, buildStringVal(""));
+		appendExpression(row, buildIntVal(8));
+		appendExpression(row, buildIntVal(1));
+		appendExpression(row, buildIntVal(1));
+		appendExpression(row, buildStringVal(""));
+		appendExpression(rows, buildAggregateInitializer(row));
+	}
+
+	for (vector<const VarSec*>::size_type i = 0; i < varVec.size(); ++i) {
+		const VarSec &var = *varVec[i];
+		SgExprListExp *row = buildExprListExp();
+		appendExpression(row, buildStringVal(AdPath(var.Name)));
+		appendExpression(row, GetEnumExpr("ADIOS_DATATYPES", var.TypeStr));
+		appendExpression(row, buildVarRefExp(SgName(var.IsReplicated ? 
+			"NC2ADIOS_DESC_REPLICATED" : "NC2ADIOS_DESC_GLOBAL")));
+		appendExpression(row, buildIntVal(var.StrVec.size()));
+		appendExpression(row, 
+			buildStringVal(AdPathList(MakeStr(var.GetDimVec(), ""))));
+		appendExpression(row, buildIntVal(var.UnitSize));
+		appendExpression(row, buildIntVal(var.IterNum));
+		appendExpression(row, buildIntVal(var.Stride));
+		appendExpression(row, buildStringVal(MakeStr(var.Reductions, "")));
+		appendExpression(rows, buildAggregateInitializer(row));
+	}
+
+	SgType *type = 
+		buildArrayType(
+			buildConstType(buildOpaqueType("nc2adios_var_desc", scope)),
+			buildIntVal(dimVec.size() + varVec.size())
+		);
+	SgVariableDeclaration *decl = 
+		buildVariableDeclaration(GetVarTableVar(suffix), type,
+			buildAggregateInitializer(rows, type));
+	setStatic(decl);
+
+	return decl;
+}
+
+
+/************************************************
+ * nc2adios_define_vars(groupVar, adios_varsXX, n,
+ *		adios_idsXX)
+ ************************************************/
+SgExprStatement *
+Group::BuildDefineVars(const string &groupVar, const string &suffix,
+	bool statsGroup)
+{
+	int num = GetAllDims().size() + GetVarOrder(statsGroup).size();
+
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, buildVarRefExp(SgName(groupVar)));
+	appendExpression(argList, buildVarRefExp(SgName(GetVarTableVar(suffix))));
+	appendExpression(argList, buildIntVal(num));
+	appendExpression(argList, buildVarRefExp(SgName(GetIdsVar(statsGroup))));
+
+	return buildFunctionCallStmt(SgName("nc2adios_define_vars"),
+		buildVoidType(), argList);
+}
+
+
+/************************************************
+ * Group size from the var table:
+ *		unsigned long long adios_extXX[] = {
+ *			count of each global var,
+ *			dims of each replicated var };
+ *		adios_groupsizeXX = nc2adios_group_size(
+ *			adios_varsXX, n, adios_extXX, adios_rankXX);
+ * Return:
+ *		SgStatement *: last inserted statement
+ ************************************************/
+SgStatement *
+Group::InsertGroupSizeTable(SgStatement *prevStmt, 
+	const string &groupSizeVarName, const string &suffix, bool statsGroup,
+	StmtBatch &batch)
+{
+	vector<const VarSec*> varVec = GetVarOrder(statsGroup);
+	SgExprListExp *extList = buildExprListExp();
+	int extNum = 0;
+
+	for (vector<const VarSec*>::size_type i = 0; i < varVec.size(); ++i) {
+		const VarSec &var = *varVec[i];
+		for (vector<string>::size_type j = 0; j < var.StrVec.size(); ++j) {
+			if (var.IsReplicated)
+				appendExpression(extList, 
+					buildVarRefExp(SgName(var.StrVec[j])));
+			else
+				appendExpression(extList, 
+					buildPntrArrRefExp(
+						buildVarRefExp(var.CountInit->get_name()),
+						buildIntVal(j)));
+			extNum++;
+		}
+	}
+	if (extNum == 0) {
+		appendExpression(extList, buildUnsignedLongLongIntVal(0));
+		extNum++;
+	}
+
+	char groupIDStr[30];
+	snprintf(groupIDStr, 30, "%d", GroupID); 
+	string extVar = string("adios_ext") + groupIDStr + suffix;
+	SgType *extType = 
+		buildArrayType(buildUnsignedLongLongType(), buildIntVal(extNum));
+	SgVariableDeclaration *extDecl = 
+		buildVariableDeclaration(extVar, extType,
+			buildAggregateInitializer(extList, extType));
+
+	SgExprListExp *argList = buildExprListExp();
+	appendExpression(argList, buildVarRefExp(SgName(GetVarTableVar(suffix))));
+	appendExpression(argList, 
+		buildIntVal(GetAllDims().size() + varVec.size()));
+	appendExpression(argList, buildVarRefExp(SgName(extVar)));
+	appendExpression(argList, (HasReplicated() || HasReductions()) ? 
+		(SgExpression *)buildVarRefExp(SgName(RankVar)) : buildIntVal(0));
+	SgExprStatement *assign = 
+		buildExprStatement(
+			buildAssignOp(
+				buildVarRefExp(groupSizeVarName),
+				buildFunctionCallExp(SgName("nc2adios_group_size"),
+					buildUnsignedLongLongType(), argList)
+			)
+		);
+
+	batch.InsertAfter(prevStmt, extDecl);
+	batch.InsertAfter(extDecl, assign);
+	return assign;
+}
+
+
 
 SgExprStatement *
-Group::BuildAdGroupSize(const string &groupSizeVarName, 
+Group::BuildAdGroupSize(const string &fileVar,
+						const string &groupSizeVarName, 
 						const string &totalSizeVarName)
 {
-	SgExpression *arg1 = buildVarRefExp(FileVar);
+	SgExpression *arg1 = buildVarRefExp(fileVar);
 	SgExpression *arg2 = buildVarRefExp(groupSizeVarName);
 	SgExpression *arg3 = 
 		buildAddressOfOp(buildVarRefExp(totalSizeVarName));
@@ -1054,9 +3152,245 @@ Group::FillIsPara()
 		IsPara = false;
 	else if (!CallVV[NC_CREATE_PAR].empty())
 		IsPara = true;
-	else {
+	else if (!CallVV[NC_OPEN_PAR].empty()) {
+		IsPara = true;
+		IsRead = true;
+	} else {
 		cout << "ERROR: no &ncid call!" << endl;
 		exit(1);
 	}
 }
 
+
+
+/************************************************
+ * Read groups: restart reads
+ *		nc_open_par, nc_inq_varid, nc_get_vara_*, 
+ *		nc_close
+ ************************************************/
+bool
+Group::IsReadGroup() const
+{
+	return IsRead;
+}
+
+
+/************************************************
+ * Extract info from the nc_open_par call
+ * Output:
+ *		string FileName, Name
+ *		SgExpression *CommExp
+ ************************************************/
+void
+Group::Extract_nc_open_par()
+{
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_OPEN_PAR];
+	assert(vec.size() == 1);
+
+	string path, pathVar;
+
+	path = ArgCharPtr(GetCallArgs(vec[0])[0], pathVar);
+	if (!path.empty()) {
+		GetNames(path);
+		cout << "\tRead file: " << FileName << endl;
+	} else {
+		cout << "\tFile name is in var: " << pathVar << endl;
+		cout << "\tSet file name to default value:" << FileName << endl;
+	}
+
+	CommExp = GetCallArgs(vec[0])[2];
+}
+
+
+/************************************************
+ * Extract var names from nc_inq_varid calls
+ * Output:
+ *		map<SgInitializedName*, string> VarNameMap:
+ *			varid to var name
+ ************************************************/
+void
+Group::Extract_nc_inq_varid()
+{
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_INQ_VARID];
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		string name, nameVar;
+		name = ArgCharPtr(GetCallArgs(vec[i])[1], nameVar);
+		if (name.empty()) {
+			Error("var name of nc_inq_varid is in var " + nameVar);
+			continue;
+		}
+		VarNameMap[ArgIntPtr_InitName(GetCallArgs(vec[i])[2])] = name;
+		cout << "\tread var: " << name << endl;
+	}
+}
+
+
+/************************************************
+ * nc_open_par(path, omode, comm, info, &ncid) 
+ * becomes
+ *		ADIOS_FILE *adios_rfileXX;
+ *		adios_read_init_method(ADIOS_READ_METHOD_BP,
+ *			comm, "");
+ *		adios_rfileXX = adios_read_open_file(FileName,
+ *			ADIOS_READ_METHOD_BP, comm);
+ ************************************************/
+void
+Group::Process_nc_open_par()
+{
+	SgStatement *orginStmt = getEnclosingStatement(CallVV[NC_OPEN_PAR][0]);
+	SgScopeStatement *scope = getScope(orginStmt);
+	pushScopeStack(scope);
+	StmtBatch batch;
+
+	InsertAdiosHeader(orginStmt);
+	InsertRuntimeHeader(orginStmt);
+
+	/***** ADIOS_FILE *, of the decl and the call *****/
+	SgType *fileType = 
+		buildPointerType(
+			buildOpaqueType("ADIOS_FILE", getGlobalScope(orginStmt)));
+	SgVariableDeclaration *fileDecl = 
+		buildVariableDeclaration(RFileVar, fileType);
+
+	SgExprListExp *initArgs = buildExprListExp();
+	appendExpression(initArgs, 
+		GetEnumExpr("ADIOS_READ_METHOD", "ADIOS_READ_METHOD_BP"));
+	appendExpression(initArgs, copyExpression(CommExp));
+	appendExpression(initArgs, buildStringVal(""));
+	SgExprStatement *initCall = 
+		buildFunctionCallStmt(SgName("adios_read_init_method"), 
+			buildIntType(), initArgs);
+
+	SgExprListExp *openArgs = buildExprListExp();
+	appendExpression(openArgs, buildStringVal(FileName));
+	appendExpression(openArgs, 
+		GetEnumExpr("ADIOS_READ_METHOD", "ADIOS_READ_METHOD_BP"));
+	appendExpression(openArgs, copyExpression(CommExp));
+	SgExprStatement *openStmt = 
+		buildExprStatement(
+			buildAssignOp(
+				buildVarRefExp(SgName(RFileVar)),
+				buildFunctionCallExp(SgName("adios_read_open_file"),
+					fileType, openArgs)
+			)
+		);
+
+	batch.InsertAfter(orginStmt, fileDecl);
+	batch.InsertAfter(fileDecl, initCall);
+	batch.InsertAfter(initCall, openStmt);
+	batch.Remove(orginStmt);
+	batch.Flush();
+	popScopeStack();
+}
+
+
+/************************************************
+ * nc_inq_varid calls go, the var name is used
+ * directly
+ ************************************************/
+void
+Group::Process_nc_inq_varid()
+{
+	StmtBatch batch;
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_INQ_VARID];
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i)
+		batch.Remove(getEnclosingStatement(vec[i]));
+	batch.Flush();
+}
+
+
+/************************************************
+ * nc_get_vara_int/float(ncid, varid, startp, 
+ *		countp, ip) becomes
+ *		nc2adios_read_vara(adios_rfileXX, name, ndims,
+ *			startp, countp, ip, comm);
+ * which reads the block this rank wrote when 
+ * the rank count did NOT change
+ ************************************************/
+void
+Group::Process_nc_get_vara()
+{
+	StmtBatch batch;
+	vector<SgFunctionCallExp*> vec = CallVV[NC_GET_VARA_INT];
+	vec.insert(vec.end(), CallVV[NC_GET_VARA_FLOAT].begin(),
+		CallVV[NC_GET_VARA_FLOAT].end());
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		const vector<SgExpression*> &args = GetCallArgs(vec[i]);
+		SgStatement *orginStmt = getEnclosingStatement(vec[i]);
+
+		map<SgInitializedName*, string>::iterator itr = 
+			VarNameMap.find(ArgVarRef_InitName(args[1]));
+		if (itr == VarNameMap.end()) {
+			cout << "ERROR: varid of nc_get_vara_* at line " 
+				<< GetCallFileLine(vec[i]) 
+				<< " is not set by nc_inq_varid. Quit." << endl;
+			exit(1);
+		}
+
+		SgArrayType *startpType = isSgArrayType(ArgVarRef_Type(args[2]));
+		assert(startpType != NULL);
+		int ndims = getArrayElementCount(startpType);
+
+		pushScopeStack(getScope(orginStmt));
+
+		SgExprListExp *argList = buildExprListExp();
+		appendExpression(argList, buildVarRefExp(SgName(RFileVar)));
+		appendExpression(argList, buildStringVal(itr->second));
+		appendExpression(argList, buildIntVal(ndims));
+		appendExpression(argList, copyExpression(args[2]));
+		appendExpression(argList, copyExpression(args[3]));
+		appendExpression(argList, copyExpression(args[4]));
+		appendExpression(argList, copyExpression(CommExp));
+		SgExprStatement *readCall = 
+			buildFunctionCallStmt(SgName("nc2adios_read_vara"), 
+				buildIntType(), argList);
+
+		batch.Replace(orginStmt, readCall);
+		popScopeStack();
+	}
+	batch.Flush();
+}
+
+
+/************************************************
+ * nc_close(ncid) becomes
+ *		adios_read_close(adios_rfileXX);
+ *		adios_read_finalize_method(ADIOS_READ_METHOD_BP);
+ ************************************************/
+void
+Group::Process_nc_close_read()
+{
+	StmtBatch batch;
+	const vector<SgFunctionCallExp*> &vec = CallVV[NC_CLOSE];
+
+	for (vector<SgFunctionCallExp*>::size_type i = 0; 
+			i != vec.size(); ++i) {
+		SgStatement *orginStmt = getEnclosingStatement(vec[i]);
+		pushScopeStack(getScope(orginStmt));
+
+		SgExprListExp *closeArgs = buildExprListExp();
+		appendExpression(closeArgs, buildVarRefExp(SgName(RFileVar)));
+		SgExprStatement *closeCall = 
+			buildFunctionCallStmt(SgName("adios_read_close"), 
+				buildIntType(), closeArgs);
+
+		SgExprListExp *finArgs = buildExprListExp();
+		appendExpression(finArgs, 
+			GetEnumExpr("ADIOS_READ_METHOD", "ADIOS_READ_METHOD_BP"));
+		SgExprStatement *finCall = 
+			buildFunctionCallStmt(SgName("adios_read_finalize_method"), 
+				buildIntType(), finArgs);
+
+		batch.InsertAfter(orginStmt, closeCall);
+		batch.InsertAfter(closeCall, finCall);
+		batch.Remove(orginStmt);
+		popScopeStack();
+	}
+	batch.Flush();
+}
@@ -2,11 +2,21 @@
 #include <numeric>
 #include <map>
 #include <vector>
+#include <set>
+#include <fstream>
+#include <cstdio>
+#include <sys/wait.h>
 #include "rose.h"
 #include "roseHelper.h"
 #include "func.h"
 #include "utils.h"
 #include "group.h"
+#include "options.h"
+#include "driver.h"
+#include "cache.h"
+#include "astfile.h"
+#include "server.h"
+#include "scan.h"
 
 using namespace std;
 using namespace RoseHelper;
@@ -15,16 +25,293 @@ using namespace SageInterface;
 
 
 
-/**********************
- * main
- **********************/
-int
-main(int argc, char *argv[])
+/****************************************
+ * Write one line per group: group name,
+ * output file name and source file
+ ****************************************/
+static void
+WriteManifest(const vector<Group*> &groupPtrVec, const string &path)
+{
+	ofstream out(path.c_str());
+
+	for (vector<Group*>::size_type i = 0; i < groupPtrVec.size(); ++i)
+		out << groupPtrVec[i]->GetName() << '\t'
+			<< groupPtrVec[i]->GetFileName() << '\t'
+			<< groupPtrVec[i]->GetSrcFileName() << endl;
+}
+
+
+/****************************************
+ * Write the adios XML config for all 
+ * groups: groups, vars, methods, buffer
+ ****************************************/
+static void
+WriteAdiosXml(const vector<Group*> &groupPtrVec, const Options &opts)
+{
+	ofstream out(opts.XmlFile.c_str());
+
+	out << "<?xml version=\"1.0\"?>" << endl;
+	out << "<adios-config host-language=\"C\">" << endl;
+	for (vector<Group*>::size_type i = 0; i < groupPtrVec.size(); ++i)
+		groupPtrVec[i]->WriteXml(out);
+	out << "  <buffer size-MB=\"" << opts.Prof.GetInt("buffer_mb", 10)
+		<< "\" allocate-time=\"now\"/>" << endl;
+	out << "</adios-config>" << endl;
+
+	cout << "ADIOS XML config: " << opts.XmlFile << endl;
+}
+
+
+/****************************************
+ * Write the standalone I/O skeleton: the
+ * var tables of all write groups and a
+ * main that replays them
+ ****************************************/
+static void
+WriteSkeleton(const vector<Group*> &groupPtrVec, const Options &opts)
+{
+	ofstream out(opts.SkeletonFile.c_str());
+	vector<string> entries;
+
+	out << "/* I/O skeleton generated by nc2adios " << NC2ADIOS_VERSION
+		<< ", link with nc2adios_rt" << endl
+		<< " * usage: prog [-m METHOD] [-p PARAMS] [-b MB] [-i N] "
+		<< "[-d NAME=VALUE]... */" << endl;
+	out << "#include \"nc2adios_rt.h\"" << endl << endl;
+	for (vector<Group*>::size_type i = 0; i < groupPtrVec.size(); ++i)
+		if (!groupPtrVec[i]->IsReadGroup())
+			groupPtrVec[i]->WriteSkeleton(out, entries);
+
+	out << "static const nc2adios_skel_group skel_groups[] = {" << endl;
+	for (vector<string>::size_type i = 0; i < entries.size(); ++i)
+		out << "\t" << entries[i] << "," << endl;
+	out << "};" << endl << endl;
+
+	out << "int" << endl << "main(int argc, char *argv[])" << endl
+		<< "{" << endl
+		<< "\treturn nc2adios_skel_main(argc, argv, skel_groups, "
+		<< entries.size() << ");" << endl
+		<< "}" << endl;
+
+	cout << "I/O skeleton: " << opts.SkeletonFile << endl;
+}
+
+
+/****************************************
+ * Unparse only the files the rewrites
+ * touched, i.e. the files holding NetCDF
+ * calls of some group. The others keep
+ * their original source and get no
+ * rose_* file; a stale one is removed if
+ * it is the output of a source on this
+ * command line and no unparsed file of
+ * this run writes it.
+ * Return:
+ *		vector<string>: sources unparsed
+ ****************************************/
+static vector<string>
+UnparseModified(SgProject *project, const vector<string> &argvList,
+		const vector< vector<SgFunctionCallExp*> > &callGroupVec)
+{
+	set<SgFile*> modSet;
+	vector<string> srcVec;
+	vector<string> skipVec;
+
+	for (vector< vector<SgFunctionCallExp*> >::size_type i = 0;
+			i < callGroupVec.size(); ++i)
+		for (vector<SgFunctionCallExp*>::size_type j = 0;
+				j < callGroupVec[i].size(); ++j)
+			modSet.insert(getEnclosingSourceFile(callGroupVec[i][j]));
+
+	for (int i = 0; i < project->numberOfFiles(); ++i) {
+		SgFile *file = &(*project)[i];
+		if (modSet.count(file) == 0) {
+			file->set_skip_unparse(true);
+			skipVec.push_back(file->getFileName());
+		} else {
+			srcVec.push_back(file->getFileName());
+		}
+	}
+
+	/***** Stale outputs of the current inputs only *****/
+	set<string> inputSet, outSet;
+	vector<string> argSrcVec = GetSrcFiles(argvList);
+	for (vector<string>::size_type i = 0; i < argSrcVec.size(); ++i)
+		inputSet.insert(AbsPath(argSrcVec[i]));
+	for (vector<string>::size_type i = 0; i < srcVec.size(); ++i)
+		outSet.insert(GetUnparseFileName(srcVec[i]));
+	for (vector<string>::size_type i = 0; i < skipVec.size(); ++i) {
+		string unparsed = GetUnparseFileName(skipVec[i]);
+		if (inputSet.count(AbsPath(skipVec[i])) != 0 &&
+				outSet.count(unparsed) == 0)
+			remove(unparsed.c_str());
+	}
+
+	cout << "Unparsing " << srcVec.size() << " of "
+		<< project->numberOfFiles() << " files" << endl;
+	project->unparse();
+
+	return srcVec;
+}
+
+
+static string
+ShellQuote(const string &arg)
+{
+	string str = "'";
+	for (string::size_type i = 0; i < arg.length(); ++i) {
+		if (arg[i] == '\'')
+			str += "'\\''";
+		else
+			str += arg[i];
+	}
+	return str + "'";
+}
+
+
+/****************************************
+ * Components of an absolute path, without
+ * empty and "." ones
+ ****************************************/
+static vector<string>
+SplitPath(const string &path)
+{
+	vector<string> vec;
+	string::size_type pos = 0, end;
+
+	while (pos < path.length()) {
+		if ( (end = path.find('/', pos)) == string::npos )
+			end = path.length();
+		string part = path.substr(pos, end - pos);
+		if (part == "..") {
+			if (!vec.empty())
+				vec.pop_back();
+		} else if (!part.empty() && part != ".") {
+			vec.push_back(part);
+		}
+		pos = end + 1;
+	}
+	return vec;
+}
+
+
+/****************************************
+ * path relative to the directory dir,
+ * both absolute; "../" where path is
+ * outside of dir
+ ****************************************/
+static string
+RelPath(const string &path, const string &dir)
+{
+	vector<string> pathVec = SplitPath(path);
+	vector<string> dirVec = SplitPath(dir);
+	vector<string>::size_type same = 0;
+	string rel;
+
+	while (same + 1 < pathVec.size() && same < dirVec.size() &&
+			pathVec[same] == dirVec[same])
+		same++;
+	for (vector<string>::size_type i = same; i < dirVec.size(); ++i)
+		rel += "../";
+	for (vector<string>::size_type i = same; i < pathVec.size(); ++i)
+		rel += pathVec[i] + (i+1 < pathVec.size() ? "/" : "");
+	return rel;
+}
+
+
+/****************************************
+ * Turn the rose_* files of srcVec into a
+ * unified diff against their sources, in
+ * opts.PatchFile. Paths in the patch are
+ * relative to opts.PatchBase, by default
+ * the directory of the patch (a/ and b/
+ * prefixed, for patch -p1).
+ * A rose_* file is removed once its diff
+ * is written.
+ ****************************************/
+static void
+WritePatch(const vector<string> &srcVec, const Options &opts)
 {
+	ofstream out(opts.PatchFile.c_str());
+	string base = opts.PatchBase;
+	int diffNum = 0;
+
+	if (base.empty())
+		base = opts.PatchFile.substr(0, opts.PatchFile.rfind('/') + 1);
+	for (vector<string>::size_type i = 0; i < srcVec.size(); ++i) {
+		string rel = RelPath(srcVec[i], base);
+		if (rel.compare(0, 3, "../") == 0)
+			cout << "WARNING: " << srcVec[i] << " is outside of " << base
+				<< ", GNU patch skips its ../ path; write the patch to a "
+				<< "directory above all sources" << endl;
+		string unparsed = GetUnparseFileName(srcVec[i]);
+		string cmd = "diff -u --label " + ShellQuote("a/" + rel)
+			+ " --label " + ShellQuote("b/" + rel) + " "
+			+ ShellQuote(srcVec[i]) + " " + ShellQuote(unparsed);
 
+		FILE *pipe = popen(cmd.c_str(), "r");
+		if (pipe == NULL) {
+			cout << "ERROR: can NOT run diff .Quit. " << endl;
+			exit(1);
+		}
+		char buf[65536];
+		size_t len;
+		while ( (len = fread(buf, 1, sizeof(buf), pipe)) > 0 )
+			out.write(buf, len);
 
-	/***** Build AST *****/
-	SgProject *project = frontend(argc, argv);
+		/***** diff: 0 same, 1 different, 2 trouble *****/
+		int status = pclose(pipe);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) > 1) {
+			cout << "ERROR: diff of " << srcVec[i] << " and " << unparsed
+				<< " failed .Quit. " << endl;
+			exit(1);
+		}
+		if (WEXITSTATUS(status) == 1)
+			diffNum++;
+		remove(unparsed.c_str());
+	}
+
+	cout << "Patch: " << opts.PatchFile << " (" << diffNum
+		<< " files)" << endl;
+}
+
+
+/****************************************
+ * Translate the files on one command line
+ ****************************************/
+static int
+Translate(vector<string> &argvList, const Options &opts)
+{
+	/***** Translation cache *****/
+	string cacheKey;
+	if (!opts.CacheDir.empty() && !opts.Scan) {
+		cacheKey = GetCacheKey(argvList, opts);
+		bool unparsed;
+		if (!cacheKey.empty() &&
+				CacheFetch(cacheKey, GetSrcFiles(argvList)[0], opts,
+					unparsed)) {
+			vector<string> srcVec;
+			if (unparsed)
+				srcVec.push_back(AbsPath(GetSrcFiles(argvList)[0]));
+			if (!opts.PatchFile.empty())
+				WritePatch(srcVec, opts);
+			return 0;
+		}
+	}
+
+	/***** Build AST, or load the one saved 
+			for the same input *****/
+	SgProject *project = NULL;
+	string astStamp;
+	if (!opts.AstDir.empty()) {
+		astStamp = GetInputStamp(argvList);
+		project = LoadAst(argvList, astStamp, opts);
+	}
+	if (project == NULL) {
+		project = frontend(argvList);
+		if (!opts.AstDir.empty())
+			SaveAst(project, argvList, astStamp, opts);
+	}
 	ROSE_ASSERT(project != NULL);
 
 	/***** In C ? *****/
@@ -51,6 +338,12 @@ main(int argc, char *argv[])
 	map<string, FUNC> funcNameIndMap;	
 	InitFuncNameIndMap(funcNameIndMap);
 
+	/***** Scan mode: report, do not translate *****/
+	if (opts.Scan) {
+		ScanProject(project, funcNameIndMap, opts);
+		return 0;
+	}
+
 	/***** Query *****/ 
 	Rose_STL_Container<SgNode*>callList =
 		NodeQuery::querySubTree(project, V_SgFunctionCallExp);
@@ -84,7 +377,7 @@ main(int argc, char *argv[])
 	for (vector< vector<SgFunctionCallExp*> >::size_type i = 0;
 			i < callGroupVec.size(); ++i) {
 		cout << "group " << i << endl;
-		groupPtrVec[i] = new Group(callGroupVec[i], funcNameIndMap, i);
+		groupPtrVec[i] = new Group(callGroupVec[i], funcNameIndMap, i, opts);
 //		for (vector<SgFunctionCallExp*>::size_type j = 0; 
 //				j < callGroupVec[i].size(); ++j) {
 //			cout << "\t" << GetCallName(callGroupVec[i][j]) << endl;
@@ -93,29 +386,115 @@ main(int argc, char *argv[])
 
 //	InsertMPI(project);
 //	groupPtrVec[0]->InsertAdiosInitFuncs();
-	cout << setw(80) << setfill('*')<< '*' << endl;
-	cout << "Processing nc_create_par..." << endl;
-	groupPtrVec[0]->Process_nc_create_par();
-	cout << setw(80) << setfill('*')<< '*' << endl;
-	cout << "Processing nc_def_dim..." << endl;
-	groupPtrVec[0]->Process_nc_def_dim();
-	cout << setw(80) << setfill('*')<< '*' << endl;
-	cout << "Extracting nc_def_var..." << endl;
-	groupPtrVec[0]->Extract_nc_def_var();
-	cout << "Extracting nc_put_vara_int..." << endl;
-	groupPtrVec[0]->Extract_nc_put_vara_int();
-	cout << "Processing nc_def_var..." << endl;
-	groupPtrVec[0]->Process_nc_def_var();
-	cout << "Process nc_enddef..." << endl;
-	groupPtrVec[0]->Process_nc_enddef();
+	for (vector<Group*>::size_type i = 0; i < groupPtrVec.size(); ++i) {
+		cout << setw(80) << setfill('*')<< '*' << endl;
+		cout << "group " << i << endl;
+
+		/***** Restart reads *****/
+		if (groupPtrVec[i]->IsReadGroup()) {
+			cout << "Extracting nc_open_par..." << endl;
+			groupPtrVec[i]->Extract_nc_open_par();
+			cout << "Extracting nc_inq_varid..." << endl;
+			groupPtrVec[i]->Extract_nc_inq_varid();
+			cout << "Processing nc_open_par..." << endl;
+			groupPtrVec[i]->Process_nc_open_par();
+			cout << "Processing nc_inq_varid..." << endl;
+			groupPtrVec[i]->Process_nc_inq_varid();
+			cout << "Processing nc_get_vara_*..." << endl;
+			groupPtrVec[i]->Process_nc_get_vara();
+			cout << "Processing nc_close..." << endl;
+			groupPtrVec[i]->Process_nc_close_read();
+			continue;
+		}
+
+		cout << "Extracting nc_create_par..." << endl;
+		groupPtrVec[i]->Extract_nc_create_par();
+		cout << "Extracting nc_def_dim..." << endl;
+		groupPtrVec[i]->Extract_nc_def_dim();
+		cout << "Extracting nc_def_var..." << endl;
+		groupPtrVec[i]->Extract_nc_def_var();
+		cout << "Extracting nc_put_vara_int..." << endl;
+		groupPtrVec[i]->Extract_nc_put_vara_int();
+		cout << "Extracting nc_put_var_float..." << endl;
+		groupPtrVec[i]->Extract_nc_put_var_float();
+	}
+
+	/***** Groups written together into one file,
+			known once all groups are extracted *****/
+	Group::Fuse(groupPtrVec);
+
+	for (vector<Group*>::size_type i = 0; i < groupPtrVec.size(); ++i) {
+		if (groupPtrVec[i]->IsReadGroup())
+			continue;
+		cout << setw(80) << setfill('*')<< '*' << endl;
+		cout << "group " << i << endl;
+		cout << "Processing nc_create_par..." << endl;
+		groupPtrVec[i]->Process_nc_create_par();
+		cout << setw(80) << setfill('*')<< '*' << endl;
+		cout << "Processing nc_def_dim..." << endl;
+		groupPtrVec[i]->Process_nc_def_dim();
+		cout << setw(80) << setfill('*')<< '*' << endl;
+		cout << "Processing nc_def_var..." << endl;
+		groupPtrVec[i]->Process_nc_def_var();
+		cout << "Process nc_enddef..." << endl;
+		groupPtrVec[i]->Process_nc_enddef();
+		cout << "Processing nc_put_vara_int..." << endl;
+		groupPtrVec[i]->Process_nc_put_vara_int();
+		cout << "Processing nc_put_var_float..." << endl;
+		groupPtrVec[i]->Process_nc_put_var_float();
+		cout << "Processing nc_redef..." << endl;
+		groupPtrVec[i]->Process_nc_redef();
+		cout << "Processing nc_sync..." << endl;
+		groupPtrVec[i]->Process_nc_sync();
+		cout << "Processing nc_put_att_text..." << endl;
+		groupPtrVec[i]->Process_nc_put_att_text();
+		cout << "Processing nc_close..." << endl;
+		groupPtrVec[i]->Process_nc_close();
+	}
+
+	if (!opts.Manifest.empty())
+		WriteManifest(groupPtrVec, opts.Manifest);
+	if (!opts.XmlFile.empty())
+		WriteAdiosXml(groupPtrVec, opts);
+	if (!opts.SkeletonFile.empty())
+		WriteSkeleton(groupPtrVec, opts);
 
 
 	AstTests::runAllTests(project);
 	AstPostProcessing(project);
-	project->unparse();
+	vector<string> srcVec = UnparseModified(project, argvList, callGroupVec);
+
+	/***** Nothing unparsed is cached too *****/
+	if (!cacheKey.empty())
+		CacheStore(cacheKey, GetSrcFiles(argvList)[0], opts, !srcVec.empty());
+	if (!opts.PatchFile.empty())
+		WritePatch(srcVec, opts);
 
 
 	return 0;
 }
 
 
+/**********************
+ * main
+ **********************/
+int
+main(int argc, char *argv[])
+{
+	vector<string> argvList(argv, argv+argc);
+	Options opts;
+
+	ParseOptions(argvList, opts);
+
+	/***** Server mode: translate jobs from clients *****/
+	if (!opts.ServerSocket.empty())
+		return RunServer(opts, Translate);
+
+	/***** Driver mode: many files, many workers *****/
+	if (!opts.FileList.empty() || !opts.CompDB.empty())
+		return RunDriver(argvList, opts);
+
+	return Translate(argvList, opts);
+}
+
+
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <cstdlib>
+#include <cassert>
+#include <unistd.h>
+#include "options.h"
+
+using namespace std;
+
+static const string OptPrefix = "-nc2adios:";
+
+/***** Options without a value *****/
+static const char *FlagKeys[] = {"scan", "tables"};
+
+
+/****************************************
+ * Is arg a "-nc2adios:" option without
+ * a value?
+ ****************************************/
+bool
+IsFlagOption(const string &arg)
+{
+	if (arg.compare(0, OptPrefix.length(), OptPrefix) != 0)
+		return false;
+	for (size_t i = 0; i < sizeof(FlagKeys)/sizeof(FlagKeys[0]); ++i)
+		if (arg.substr(OptPrefix.length()) == FlagKeys[i])
+			return true;
+	return false;
+}
+
+
+/****************************************
+ * Return the value following option i,
+ * quit if there is none
+ ****************************************/
+static string
+OptValue(const vector<string> &argvList, vector<string>::size_type &i)
+{
+	assert(!IsFlagOption(argvList[i]));
+	if (i+1 >= argvList.size()) {
+		cout << "ERROR: option " << argvList[i]
+			<< " needs a value. Quit." << endl;
+		exit(1);
+	}
+	return argvList[++i];
+}
+
+
+/****************************************
+ * Absolute form of a path, driver workers
+ * may run in another directory
+ ****************************************/
+string
+AbsPath(const string &path)
+{
+	char buf[4096];
+
+	if (path.empty() || path[0] == '/' || getcwd(buf, sizeof(buf)) == NULL)
+		return path;
+	return string(buf) + "/" + path;
+}
+
+
+/**************************************************
+ * Strip "-nc2adios:" options off argvList
+ **************************************************/
+void
+ParseOptions(vector<string> &argvList, Options &opts)
+{
+	vector<string> rest;
+	string key;
+	vector<string>::size_type first;
+
+	for (vector<string>::size_type i = 0; i < argvList.size(); ++i) {
+		first = i;
+
+		/***** Not ours, leave it to the frontend *****/
+		if (argvList[i].compare(0, OptPrefix.length(), OptPrefix) != 0) {
+			rest.push_back(argvList[i]);
+			continue;
+		}
+
+		key = argvList[i].substr(OptPrefix.length());
+		if (key == "filelist") {
+			opts.FileList = OptValue(argvList, i);
+		} else if (key == "compdb") {
+			opts.CompDB = OptValue(argvList, i);
+		} else if (key == "jobs") {
+			opts.Jobs = atoi(OptValue(argvList, i).c_str());
+		} else if (key == "manifest") {
+			opts.Manifest = OptValue(argvList, i);
+		} else if (key == "xml") {
+			opts.XmlFile = OptValue(argvList, i);
+		} else if (key == "server") {
+			opts.ServerSocket = OptValue(argvList, i);
+		} else if (key == "scan") {
+			opts.Scan = true;
+		} else if (key == "tables") {
+			opts.Tables = true;
+		} else if (key == "skeleton") {
+			opts.SkeletonFile = OptValue(argvList, i);
+		} else if (key == "patch") {
+			opts.PatchFile = AbsPath(OptValue(argvList, i));
+			argvList[i] = opts.PatchFile;
+		} else if (key == "patch-base") {
+			opts.PatchBase = AbsPath(OptValue(argvList, i));
+			argvList[i] = opts.PatchBase;
+		} else if (key == "cache") {
+			opts.CacheDir = AbsPath(OptValue(argvList, i));
+			argvList[i] = opts.CacheDir;
+		} else if (key == "ast") {
+			opts.AstDir = AbsPath(OptValue(argvList, i));
+			argvList[i] = opts.AstDir;
+		} else if (key == "profile") {
+			argvList[i] = AbsPath(OptValue(argvList, i));
+			opts.Prof.Load(argvList[i]);
+		} else {
+			cout << "ERROR: unknown option: " << argvList[i]
+				<< " .Quit. " << endl;
+			exit(1);
+		}
+
+		/***** Driver options stay with the driver *****/
+		if (key == "filelist" || key == "compdb" || key == "jobs" ||
+				key == "manifest" || key == "server" || key == "patch" ||
+				key == "patch-base")
+			continue;
+		opts.WorkerOpts.insert(opts.WorkerOpts.end(),
+			argvList.begin()+first, argvList.begin()+i+1);
+
+		/***** Options that may change the output
+				go into the translation cache key *****/
+		if (key != "cache" && key != "profile" && key != "ast")
+			opts.KeyOpts.insert(opts.KeyOpts.end(),
+				argvList.begin()+first, argvList.begin()+i+1);
+	}
+
+	argvList.swap(rest);
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include "profile.h"
+
+using namespace std;
+
+
+/**********************************************
+ * Read the profile
+ **********************************************/
+void
+Profile::Load(const string &path)
+{
+	ifstream in(path.c_str());
+	stringstream text;
+	string line, key, word;
+
+	if (!in) {
+		cout << "ERROR: can NOT open profile " << path << " .Quit. " << endl;
+		exit(1);
+	}
+	text << in.rdbuf();
+	Text = text.str();
+	EntryMap.clear();
+
+	istringstream lines(Text);
+	while (getline(lines, line)) {
+		istringstream words(line.substr(0, line.find('#')));
+		if (!(words >> key))
+			continue;
+
+		Entry entry;
+		while (words >> word)
+			entry.push_back(word);
+		EntryMap[key].push_back(entry);
+	}
+}
+
+
+const string &
+Profile::GetText() const
+{
+	return Text;
+}
+
+
+const vector<Profile::Entry> &
+Profile::GetAll(const string &key) const
+{
+	static const vector<Entry> none;
+
+	map<string, vector<Entry> >::const_iterator itr = EntryMap.find(key);
+	if (itr == EntryMap.end())
+		return none;
+	return itr->second;
+}
+
+
+string
+Profile::GetStr(const string &key, const string &def) const
+{
+	const vector<Entry> &vec = GetAll(key);
+
+	if (vec.empty() || vec.back().empty())
+		return def;
+	return vec.back()[0];
+}
+
+
+int
+Profile::GetInt(const string &key, int def) const
+{
+	string str = GetStr(key, string());
+
+	if (str.empty())
+		return def;
+	return atoi(str.c_str());
+}
+
+
+string
+Profile::GetLine(const string &key, const string &def) const
+{
+	const vector<Entry> &vec = GetAll(key);
+	string line;
+
+	if (vec.empty() || vec.back().empty())
+		return def;
+	for (Entry::size_type i = 0; i < vec.back().size(); ++i)
+		line += (i == 0 ? "" : " ") + vec.back()[i];
+	return line;
+}
@@ -0,0 +1,539 @@
+#include <sstream>
+#include "roseHelper.h"
+#include "utils.h"
+#include "group.h"
+#include "scan.h"
+
+using namespace std;
+using namespace RoseHelper;
+using namespace SageInterface;
+
+
+/*************************************************
+ * Report
+ *************************************************/
+string
+ScanReport::Where(SgFunctionCallExp *callExp)
+{
+	ostringstream str;
+	str << GetCallFileName(callExp) << ":" << GetCallFileLine(callExp)
+		<< " " << GetCallName(callExp);
+	return str.str();
+}
+
+void
+ScanReport::AddCall(const string &funcName, bool supported)
+{
+	if (supported)
+		SupportedMap[funcName]++;
+	else
+		UnsupportedMap[funcName]++;
+}
+
+void
+ScanReport::AddBlock(SgFunctionCallExp *callExp, const string &reason)
+{
+	BlockVec.push_back(Where(callExp) + ": " + reason);
+}
+
+void
+ScanReport::AddNote(SgFunctionCallExp *callExp, const string &note)
+{
+	NoteVec.push_back(Where(callExp) + ": " + note);
+}
+
+void
+ScanReport::AddGroup(const string &desc, bool ok)
+{
+	GroupNum++;
+	if (ok)
+		GoodGroupNum++;
+	GroupVec.push_back( (ok ? "OK      " : "BLOCKED ") + desc );
+}
+
+void
+ScanReport::Print(ostream &out) const
+{
+	int supportedNum = 0, unsupportedNum = 0;
+	map<string, int>::const_iterator itr;
+
+	for (itr = SupportedMap.begin(); itr != SupportedMap.end(); ++itr)
+		supportedNum += itr->second;
+	for (itr = UnsupportedMap.begin(); itr != UnsupportedMap.end(); ++itr)
+		unsupportedNum += itr->second;
+
+	out << "NetCDF call sites: " << supportedNum + unsupportedNum
+		<< " (supported " << supportedNum
+		<< ", unsupported " << unsupportedNum << ")" << endl;
+	for (itr = SupportedMap.begin(); itr != SupportedMap.end(); ++itr)
+		out << "\t" << setw(30) << left << itr->first << itr->second << endl;
+	for (itr = UnsupportedMap.begin(); itr != UnsupportedMap.end(); ++itr)
+		out << "\t" << setw(30) << left << itr->first << itr->second
+			<< " (unsupported)" << endl;
+
+	out << "Groups: " << GroupNum << " (translatable " << GoodGroupNum
+		<< "), dims: " << DimNum << ", vars: " << VarNum << endl;
+	for (vector<string>::size_type i = 0; i < GroupVec.size(); ++i)
+		out << "\t" << GroupVec[i] << endl;
+
+	out << "Blocking constructs: " << BlockVec.size() << endl;
+	for (vector<string>::size_type i = 0; i < BlockVec.size(); ++i)
+		out << "\t" << BlockVec[i] << endl;
+
+	if (!NoteVec.empty()) {
+		out << "Notes: " << NoteVec.size() << endl;
+		for (vector<string>::size_type i = 0; i < NoteVec.size(); ++i)
+			out << "\t" << NoteVec[i] << endl;
+	}
+}
+
+
+/*************************************************
+ * Non-asserting argument shape tests
+ *************************************************/
+static SgExpression *
+StripCast(SgExpression *exp)
+{
+	if (exp->variantT() == V_SgCastExp)
+		exp = (static_cast<SgCastExp*>(exp))->get_operand();
+	return exp;
+}
+
+static bool
+IsIntLit(SgExpression *exp)
+{
+	return exp->variantT() == V_SgIntVal;
+}
+
+static bool
+IsStrLit(SgExpression *exp)
+{
+	return StripCast(exp)->variantT() == V_SgStringVal;
+}
+
+static bool
+IsStrOrVar(SgExpression *exp)
+{
+	exp = StripCast(exp);
+	return exp->variantT() == V_SgStringVal ||
+		exp->variantT() == V_SgVarRefExp;
+}
+
+static bool
+IsVar(SgExpression *exp)
+{
+	return StripCast(exp)->variantT() == V_SgVarRefExp;
+}
+
+/***** What ArgIntPtr_InitName accepts *****/
+static bool
+IsVarOrAddrOfVar(SgExpression *exp)
+{
+	exp = StripCast(exp);
+	if (exp->variantT() == V_SgAddressOfOp)
+		exp = (static_cast<SgAddressOfOp*>(exp))->get_operand();
+	return exp->variantT() == V_SgVarRefExp;
+}
+
+static bool
+Is1DArrayVar(SgExpression *exp)
+{
+	if (!IsVar(exp))
+		return false;
+	SgType *type = ArgVarRef_Type(exp);
+	return type->variantT() == V_SgArrayType &&
+		getDimensionCount(type) == 1;
+}
+
+
+/*************************************************
+ * ncid declaration of a NetCDF call, NULL if
+ * it is not a plain variable
+ *************************************************/
+static SgInitializedName *
+SafeNcid(SgFunctionCallExp *callExp)
+{
+	const vector<SgExpression*> &args = GetCallArgs(callExp);
+	string funcName = GetCallName(callExp);
+	SgExpression *exp;
+
+	if (funcName == "nc_create" && args.size() > 2)
+		exp = args[2];
+	else if ( (funcName == "nc_create_par" || funcName == "nc_open_par") &&
+			args.size() > 4 )
+		exp = args[4];
+	else if (!args.empty())
+		exp = args[0];
+	else
+		return NULL;
+
+	if (!IsVarOrAddrOfVar(exp))
+		return NULL;
+	return ArgIntPtr_InitName(exp);
+}
+
+
+/**************************************************
+ * Check the argument shapes of a supported call
+ **************************************************/
+string
+CheckCall(SgFunctionCallExp *callExp, FUNC func, string &note)
+{
+	const vector<SgExpression*> &args = GetCallArgs(callExp);
+	SgExpression *exp;
+
+	note.clear();
+	switch (func) {
+
+	case NC_CREATE:
+		return "serial nc_create is not translated, only nc_create_par";
+
+	case NC_CREATE_PAR:
+		if (!IsStrOrVar(args[0]))
+			return "path is neither a string literal nor a variable";
+		if (StripCast(args[0])->variantT() == V_SgVarRefExp)
+			note = "path is in a variable, the default file name is used";
+		exp = args[1];
+		if (exp->variantT() == V_SgBitOrOp) {
+			SgBitOrOp *op = isSgBitOrOp(exp);
+			if (!IsIntLit(op->get_lhs_operand()) ||
+					!IsIntLit(op->get_rhs_operand()))
+				return "cmode is not an or of int constants";
+		} else if (!IsIntLit(exp)) {
+			return "cmode is not an int constant";
+		}
+		if (!IsVarOrAddrOfVar(args[4]))
+			return "ncidp is not the address of a variable";
+		return string();
+
+	case NC_DEF_DIM:
+		if (!IsStrOrVar(args[1]))
+			return "dim name is neither a string literal nor a variable";
+		exp = args[3];
+		if (exp->variantT() == V_SgAddOp) {
+			SgAddOp *op = static_cast<SgAddOp*>(exp);
+			if (!IsVar(op->get_lhs_operand()) ||
+					!IsIntLit(op->get_rhs_operand()))
+				return "idp is not array + int constant";
+		} else if (exp->variantT() != V_SgAddressOfOp &&
+				exp->variantT() != V_SgVarRefExp) {
+			return "unsupported idp expression " + exp->class_name();
+		} else if (!IsVarOrAddrOfVar(exp)) {
+			return "idp is not the address of a variable";
+		}
+		return string();
+
+	case NC_DEF_VAR:
+		if (!IsStrOrVar(args[1]))
+			return "var name is neither a string literal nor a variable";
+		exp = args[2];
+		if (exp->variantT() != V_SgCastExp || !IsIntLit(StripCast(exp)))
+			return "xtype is not a constant";
+		if (ArgCastInt(exp) != 4 && ArgCastInt(exp) != 5)
+			return "unsupported xtype, only NC_INT and NC_FLOAT";
+		if (!IsIntLit(args[3]))
+			return "ndims is not an int constant";
+		if (!IsVarOrAddrOfVar(args[4]))
+			return "dimidsp is not a variable";
+		if (!IsVarOrAddrOfVar(args[5]))
+			return "varidp is not the address of a variable";
+		return string();
+
+	case NC_PUT_VARA_INT: {
+		if (!IsVar(args[1]))
+			return "varid is not a variable";
+		if (!Is1DArrayVar(args[2]) || !Is1DArrayVar(args[3]))
+			return "startp/countp are not 1-D array variables";
+		/***** Same rules as Extract_nc_put_vara_int:
+				in an OpenMP region the loop is the one
+				around the region *****/
+		SgStatement *stmt = getEnclosingStatement(callExp);
+		SgStatement *region = GetOmpRegion(stmt);
+		if (region != NULL) {
+			if (isAncestor(region, ArgVarRef_InitName(args[3])))
+				return "countp is declared in its OpenMP parallel region";
+			if (GetOmpRegion(isSgStatement(region->get_parent())) != NULL)
+				return "in a nested OpenMP parallel region";
+			note = "OpenMP threads pack one block per rank";
+		}
+		SgForStatement *forStmt = GetPutLoop(stmt);
+		if (forStmt == NULL)
+			return region != NULL ? 
+				"OpenMP parallel region not inside a for loop" :
+				"not inside a for loop";
+		if (!IsCanonicalForStmt(forStmt))
+			return "enclosing for loop does not have constant bounds";
+		return string();
+	}
+
+	case NC_PUT_VAR_FLOAT:
+		if (!IsVar(args[1]))
+			return "varid is not a variable";
+		if (GetOmpRegion(getEnclosingStatement(callExp)) != NULL)
+			return "whole var written in an OpenMP parallel region";
+		note = "whole var, written by rank 0 only";
+		return string();
+
+	case NC_CLOSE:
+		note = "adios_close after writes, adios_read_close after reads";
+		return string();
+
+	case NC_REDEF:
+		note = "define mode is free in ADIOS, dropped";
+		return string();
+
+	case NC_SYNC:
+		note = "step boundary or dropped, per profile";
+		return string();
+
+	case NC_PUT_ATT_TEXT:
+		if (!IsStrLit(args[2]))
+			return "attribute name is not a string literal";
+		if (args[1]->variantT() == V_SgVarRefExp)
+			note = "attribute of a var, defined if the var is";
+		return string();
+
+	case NC_OPEN_PAR:
+		if (!IsStrOrVar(args[0]))
+			return "path is neither a string literal nor a variable";
+		if (!IsVarOrAddrOfVar(args[4]))
+			return "ncidp is not the address of a variable";
+		return string();
+
+	case NC_INQ_VARID:
+		if (!IsStrLit(args[1]))
+			return "var name is not a string literal";
+		if (!IsVarOrAddrOfVar(args[2]))
+			return "varidp is not the address of a variable";
+		return string();
+
+	case NC_GET_VARA_INT:
+	case NC_GET_VARA_FLOAT:
+		if (!IsVar(args[1]))
+			return "varid is not a variable";
+		if (!Is1DArrayVar(args[2]) || !Is1DArrayVar(args[3]))
+			return "startp/countp are not 1-D array variables";
+		note = "restart read, write-block selection on the same rank count";
+		return string();
+
+	default:
+		return string();
+	}
+}
+
+
+/**************************************************
+ * Scan one group: run the Extract_* analysis
+ * where the arguments allow it, never quit.
+ * What Extract_* can NOT handle goes to the
+ * reasons of the group through ErrVec.
+ **************************************************/
+void
+Group::Scan(ScanReport &report)
+{
+	ostringstream desc;
+	vector<string> reasons;
+
+	/***** Restart reads *****/
+	if (IsRead) {
+		if (CallVV[NC_OPEN_PAR].size() != 1) {
+			desc << "group " << GroupID << ": needs exactly one nc_open_par";
+			report.AddGroup(desc.str(), false);
+			return;
+		}
+		ErrVec = &reasons;
+		Extract_nc_open_par();
+		Extract_nc_inq_varid();
+		ErrVec = NULL;
+		desc << "group " << GroupID << " read <- " << FileName 
+			<< ": vars " << VarNameMap.size();
+		for (vector<string>::size_type i = 0; i < reasons.size(); ++i)
+			desc << "\n\t\t" << reasons[i];
+		report.AddGroup(desc.str(), reasons.empty());
+		return;
+	}
+
+	if (!IsPara || CallVV[NC_CREATE_PAR].size() != 1) {
+		desc << "group " << GroupID << ": needs exactly one nc_create_par";
+		report.AddGroup(desc.str(), false);
+		return;
+	}
+	ErrVec = &reasons;
+	Extract_nc_create_par();
+
+	if (CallVV[NC_ENDDEF].empty())
+		reasons.push_back("needs an nc_enddef");
+	CheckRedefPairs();
+
+	/***** Dims *****/
+	Extract_nc_def_dim();
+
+	/***** Vars, only those whose dims are all known *****/
+	for (vector<SgFunctionCallExp*>::size_type i = 0;
+			i != CallVV[NC_DEF_VAR].size(); ++i) {
+		SgFunctionCallExp *callExp = CallVV[NC_DEF_VAR][i];
+		SgInitializedName *dimidsp =
+			ArgIntPtr_InitName(GetCallArgs(callExp)[4]);
+		int ndims = ArgInt_Val(GetCallArgs(callExp)[3]);
+
+		map<SgInitializedName*, vector<string> >::iterator itr =
+			DimMap.find(dimidsp);
+		if (itr == DimMap.end() || (int)itr->second.size() != ndims) {
+			ostringstream reason;
+			reason << "dimids of var at line " << GetCallFileLine(callExp)
+				<< " do not match nc_def_dim calls";
+			reasons.push_back(reason.str());
+			continue;
+		}
+		ExtractOne_nc_def_var(callExp);
+	}
+	FillStats();
+	FillRollover();
+
+	/***** Put *****/
+	if (CallVV[NC_PUT_VARA_INT].size() != 1) {
+		reasons.push_back("needs exactly one nc_put_vara_int");
+	} else {
+		SgFunctionCallExp *callExp = CallVV[NC_PUT_VARA_INT][0];
+		map<SgInitializedName*, VarSec>::iterator itr = VarMap.find(
+			ArgVarRef_InitName(GetCallArgs(callExp)[1]));
+		if (itr == VarMap.end()) {
+			reasons.push_back("nc_put_vara_int writes an unknown varid");
+		} else {
+			size_t ndims = itr->second.StrVec.size();
+			SgArrayType *startpType = isSgArrayType(
+				ArgVarRef_Type(GetCallArgs(callExp)[2]));
+			SgArrayType *countpType = isSgArrayType(
+				ArgVarRef_Type(GetCallArgs(callExp)[3]));
+			if (getArrayElementCount(startpType) != ndims ||
+					getArrayElementCount(countpType) != ndims)
+				reasons.push_back("startp/countp length is not ndims");
+			else
+				Extract_nc_put_vara_int();
+		}
+	}
+
+	/***** Whole var puts *****/
+	bool putVarOk = true;
+	for (vector<SgFunctionCallExp*>::size_type i = 0;
+			i != CallVV[NC_PUT_VAR_FLOAT].size(); ++i) {
+		map<SgInitializedName*, VarSec>::iterator itr = VarMap.find(
+			ArgVarRef_InitName(GetCallArgs(CallVV[NC_PUT_VAR_FLOAT][i])[1]));
+		if (itr == VarMap.end() || itr->second.IsGlobal) {
+			reasons.push_back("nc_put_var_float writes an unknown varid "
+				"or a var also written by nc_put_vara_int");
+			putVarOk = false;
+		}
+	}
+	if (putVarOk)
+		Extract_nc_put_var_float();
+
+	for (map<SgInitializedName*, VarSec>::iterator itr = VarMap.begin();
+			itr != VarMap.end(); ++itr)
+		if (!itr->second.IsGlobal && !itr->second.IsReplicated)
+			reasons.push_back("var " + itr->second.Name +
+				" is not written by nc_put_vara_int or nc_put_var_float");
+	ErrVec = NULL;
+
+	report.DimNum += DimMap.size();
+	report.VarNum += VarMap.size();
+
+	desc << "group " << GroupID << " \"" << Name << "\" -> " << FileName
+		<< ": dims " << DimMap.size() << ", vars " << VarMap.size();
+	for (vector<string>::size_type i = 0; i < reasons.size(); ++i)
+		desc << "\n\t\t" << reasons[i];
+	report.AddGroup(desc.str(), reasons.empty());
+}
+
+
+/**************************************************
+ * Scan mode
+ **************************************************/
+void
+ScanProject(SgProject *project, const map<string, FUNC> &funcNameIndMap,
+			const Options &opts)
+{
+	ScanReport report;
+	vector<SgFunctionCallExp*> ncCall, unsupported;
+	map<SgInitializedName*, int> ncidMap;
+	vector< vector<SgFunctionCallExp*> > callGroupVec;
+	vector<bool> blockedVec;
+	SgInitializedName *ncid;
+	string note, reason;
+
+	Rose_STL_Container<SgNode*> callList =
+		NodeQuery::querySubTree(project, V_SgFunctionCallExp);
+	FilterCall(callList, ncCall, funcNameIndMap, &unsupported);
+
+	/***** Groups from create calls *****/
+	for (vector<SgFunctionCallExp*>::size_type i = 0;
+			i != ncCall.size(); ++i) {
+		string funcName = GetCallName(ncCall[i]);
+		if (funcName != "nc_create" && funcName != "nc_create_par" &&
+				funcName != "nc_open_par")
+			continue;
+		if ( (ncid = SafeNcid(ncCall[i])) != NULL &&
+				ncidMap.find(ncid) == ncidMap.end() ) {
+			ncidMap.insert(make_pair(ncid, (int)callGroupVec.size()));
+			callGroupVec.push_back(vector<SgFunctionCallExp*>());
+			blockedVec.push_back(false);
+		}
+	}
+
+	/***** Classify every supported call *****/
+	for (vector<SgFunctionCallExp*>::size_type i = 0;
+			i != ncCall.size(); ++i) {
+		SgFunctionCallExp *callExp = ncCall[i];
+		string funcName = GetCallName(callExp);
+		report.AddCall(funcName, true);
+
+		reason = CheckCall(callExp, funcNameIndMap.find(funcName)->second,
+			note);
+		if (!note.empty())
+			report.AddNote(callExp, note);
+
+		map<SgInitializedName*, int>::iterator itr = ncidMap.end();
+		if ( (ncid = SafeNcid(callExp)) != NULL )
+			itr = ncidMap.find(ncid);
+		if (itr == ncidMap.end()) {
+			report.AddBlock(callExp,
+				"ncid is not created by nc_create/nc_create_par/nc_open_par");
+			continue;
+		}
+
+		callGroupVec[itr->second].push_back(callExp);
+		if (!reason.empty()) {
+			report.AddBlock(callExp, reason);
+			blockedVec[itr->second] = true;
+		}
+	}
+
+	/***** Unsupported calls block their group *****/
+	for (vector<SgFunctionCallExp*>::size_type i = 0;
+			i != unsupported.size(); ++i) {
+		report.AddCall(GetCallName(unsupported[i]), false);
+		report.AddBlock(unsupported[i], "unsupported NetCDF function");
+		if ( (ncid = SafeNcid(unsupported[i])) != NULL &&
+				ncidMap.find(ncid) != ncidMap.end() )
+			blockedVec[ncidMap[ncid]] = true;
+	}
+
+	/***** Extract_* analysis, quietly: its progress
+			log is dropped, its errors go to the report *****/
+	ostringstream sink;
+	streambuf *coutBuf = cout.rdbuf(sink.rdbuf());
+	for (vector< vector<SgFunctionCallExp*> >::size_type i = 0;
+			i < callGroupVec.size(); ++i) {
+		if (blockedVec[i]) {
+			ostringstream desc;
+			desc << "group " << i << ": blocked by the calls listed below";
+			report.AddGroup(desc.str(), false);
+			continue;
+		}
+		Group group(callGroupVec[i], funcNameIndMap, i, opts);
+		group.Scan(report);
+	}
+	cout.rdbuf(coutBuf);
+
+	report.Print(cout);
+}
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+#include "driver.h"
+
+using namespace std;
+
+
+/****************************************
+ * Read a job request: the client shuts
+ * down writing when it is complete
+ ****************************************/
+static bool
+ReadRequest(int fd, string &cwd, vector<string> &argvList)
+{
+	string data;
+	char buf[4096];
+	ssize_t len;
+
+	while ( (len = read(fd, buf, sizeof(buf))) > 0 )
+		data.append(buf, len);
+	if (len < 0)
+		return false;
+
+	string::size_type start = 0, end;
+	while ( (end = data.find('\0', start)) != string::npos ) {
+		if (start == 0)
+			cwd = data.substr(0, end);
+		else
+			argvList.push_back(data.substr(start, end-start));
+		start = end + 1;
+	}
+	return !cwd.empty() && !argvList.empty();
+}
+
+
+/****************************************
+ * Run one job in a forked copy of the 
+ * server, output to the connection
+ * Return:
+ *		int: exit status of the job
+ ****************************************/
+static int
+RunJob(int fd, const string &cwd, vector<string> &argvList,
+		TranslateFunc translate)
+{
+	cout.flush();
+	pid_t pid = fork();
+	if (pid < 0)
+		return 127;
+
+	if (pid == 0) {
+		dup2(fd, 1);
+		dup2(fd, 2);
+		close(fd);
+		if (chdir(cwd.c_str()) != 0) {
+			perror(cwd.c_str());
+			_exit(127);
+		}
+
+		Options opts;
+		ParseOptions(argvList, opts);
+		if (!opts.FileList.empty() || !opts.CompDB.empty())
+			exit(RunDriver(argvList, opts));
+		exit(translate(argvList, opts));
+	}
+
+	int status;
+	if (waitpid(pid, &status, 0) < 0)
+		return 127;
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+	return 128 + WTERMSIG(status);
+}
+
+
+/****************************************
+ * Handle one connection, in its own
+ * process so jobs run concurrently
+ ****************************************/
+static void
+Serve(int fd, TranslateFunc translate)
+{
+	string cwd;
+	vector<string> argvList;
+	int status = 127;
+
+	if (ReadRequest(fd, cwd, argvList))
+		status = RunJob(fd, cwd, argvList, translate);
+
+	char tail[64];
+	int len = snprintf(tail, sizeof(tail), "\n%s%d\n", 
+		NC2ADIOS_EXIT_TAG, status);
+	if (write(fd, tail, len) != len)
+		perror("write");
+	close(fd);
+}
+
+
+/**************************************************
+ * Serve jobs on opts.ServerSocket
+ **************************************************/
+int
+RunServer(const Options &opts, TranslateFunc translate)
+{
+	struct sockaddr_un addr;
+	const string &path = opts.ServerSocket;
+
+	if (path.length() >= sizeof(addr.sun_path)) {
+		cout << "ERROR: socket path too long: " << path << " .Quit. " << endl;
+		return 1;
+	}
+
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		perror("socket");
+		return 1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path.c_str());
+
+	unlink(path.c_str());
+	if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+			listen(sock, 64) != 0) {
+		perror(path.c_str());
+		return 1;
+	}
+
+	/***** Finished connection handlers are reaped
+			by the kernel; a client going away must
+			NOT kill the server *****/
+	signal(SIGCHLD, SIG_IGN);
+	signal(SIGPIPE, SIG_IGN);
+
+	cout << "nc2adios " << NC2ADIOS_VERSION << " serving on " 
+		<< path << endl;
+
+	for (;;) {
+		int fd = accept(sock, NULL, NULL);
+		if (fd < 0)
+			continue;
+
+		cout.flush();
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(sock);
+			signal(SIGCHLD, SIG_DFL);
+			signal(SIGPIPE, SIG_DFL);
+			Serve(fd, translate);
+			_exit(0);
+		}
+		if (pid < 0)
+			perror("fork");
+		close(fd);
+	}
+}
@@ -0,0 +1,101 @@
+#include <sstream>
+#include "utils.h"
+#include "group.h"
+
+using namespace std;
+
+
+/*************************************************
+ * C string literal
+ *************************************************/
+static string
+CStr(const string &str)
+{
+	string lit = "\"";
+	for (string::size_type i = 0; i < str.length(); ++i) {
+		if (str[i] == '"' || str[i] == '\\')
+			lit += '\\';
+		lit += str[i];
+	}
+	return lit + "\"";
+}
+
+
+/*************************************************
+ * Var and dim tables of a standalone I/O
+ * skeleton:
+ *		static nc2adios_skel_dim skel_dimsXX[] = {
+ *			{name, len or 0, base dim, stride}, ...};
+ *		static const nc2adios_var_desc skel_varsXX[]
+ *			= {dims, then vars in def_var order};
+ * The var tables hold the stored dims, so the
+ * stride of every var is 1: the skeleton writes
+ * the decimated block as it is.
+ *************************************************/
+void
+Group::WriteSkeleton(ostream &out, vector<string> &entries) const
+{
+	vector<string> dimVec = GetAllDims();
+	ostringstream dimsVar, entry;
+
+	dimsVar << "skel_dims" << GroupID;
+
+	/***** Dims: constant len of nc_def_dim, or
+			decimated from a dim *****/
+	out << "static nc2adios_skel_dim " << dimsVar.str() << "[] = {" << endl;
+	for (vector<string>::size_type i = 0; i < dimVec.size(); ++i) {
+		map<string, unsigned long long>::const_iterator lenItr =
+			DimLenMap.find(dimVec[i]);
+		string base = "NULL";
+		int stride = 1;
+
+		for (map<SgInitializedName*, VarSec>::const_iterator
+				itr = VarMap.begin();
+				itr != VarMap.end() && lenItr == DimLenMap.end(); ++itr) {
+			vector<string> reducedVec = itr->second.GetDimVec();
+			for (vector<string>::size_type j = 0;
+					j < reducedVec.size() && itr->second.Stride > 1; ++j)
+				if (reducedVec[j] == dimVec[i]) {
+					base = CStr(itr->second.StrVec[j]);
+					stride = itr->second.Stride;
+				}
+		}
+		out << "\t{" << CStr(dimVec[i]) << ", "
+			<< (lenItr != DimLenMap.end() ? lenItr->second : 0) << "ULL, "
+			<< base << ", " << stride << "}," << endl;
+	}
+	out << "};" << endl << endl;
+
+	for (int statsGroup = 0; statsGroup < (HasStatsGroup ? 2 : 1);
+			++statsGroup) {
+		vector<const VarSec*> varVec = GetVarOrder(statsGroup);
+		ostringstream varsVar;
+
+		varsVar << "skel_vars" << GroupID << (statsGroup ? "_stats" : "");
+		out << "static const nc2adios_var_desc " << varsVar.str()
+			<< "[] = {" << endl;
+		for (vector<string>::size_type i = 0; i < dimVec.size(); ++i)
+			out << "\t{" << CStr(dimVec[i]) << ", adios_unsigned_long, "
+				<< "NC2ADIOS_DESC_DIM, 0, \"\", 8, 1, 1, \"\"}," << endl;
+		for (vector<const VarSec*>::size_type i = 0; i < varVec.size(); ++i) {
+			const VarSec &var = *varVec[i];
+			out << "\t{" << CStr(var.Name) << ", " << var.TypeStr << ", "
+				<< (var.IsReplicated ?
+					"NC2ADIOS_DESC_REPLICATED" : "NC2ADIOS_DESC_GLOBAL")
+				<< ", " << var.StrVec.size() << ", "
+				<< CStr(MakeStr(var.GetDimVec(), "")) << ", "
+				<< var.UnitSize << ", " << var.IterNum << ", 1, "
+				<< CStr(MakeStr(var.Reductions, "")) << "}," << endl;
+		}
+		out << "};" << endl << endl;
+
+		entry.str("");
+		entry << "{"
+			<< CStr(statsGroup ? StatsName : Name) << ", "
+			<< CStr(statsGroup ? StatsFileName : FileName) << ", "
+			<< ((statsGroup || StatsOn) ? 1 : 0) << ", "
+			<< varsVar.str() << ", " << dimVec.size() + varVec.size() << ", "
+			<< dimsVar.str() << ", " << dimVec.size() << "}";
+		entries.push_back(entry.str());
+	}
+}
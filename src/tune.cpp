@@ -0,0 +1,346 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+
+/**************************************************
+ * nc2adios-tune: local auto-tuner. Runs an I/O
+ * skeleton (-nc2adios:skeleton) under mpirun for
+ * every combination of transport method, buffer
+ * size, aggregator count, statistics and flush
+ * cadence, and writes the fastest settings that
+ * fit the memory limit into a translation profile
+ * or an ADIOS XML config.
+ *		$NC2ADIOS_MPIRUN	launcher, default mpirun
+ **************************************************/
+
+
+struct Setting
+{
+	string Method;
+	string Params;
+	int BufferMB;
+	bool Stats;
+	int Flush;					// puts between close/reopen, 0 = never
+};
+
+struct Result
+{
+	double MBps;
+	long PeakKB;				// peak RSS of the largest rank
+};
+
+
+static string
+GetEnv(const char *name, const char *def)
+{
+	const char *val = getenv(name);
+	return (val != NULL && *val != '\0') ? val : def;
+}
+
+
+static vector<string>
+SplitList(const string &list)
+{
+	vector<string> vec;
+	string item;
+	istringstream in(list);
+
+	while (getline(in, item, ','))
+		if (!item.empty())
+			vec.push_back(item);
+	return vec;
+}
+
+
+static string
+ShellQuote(const string &arg)
+{
+	string str = "'";
+	for (string::size_type i = 0; i < arg.length(); ++i) {
+		if (arg[i] == '\'')
+			str += "'\\''";
+		else
+			str += arg[i];
+	}
+	return str + "'";
+}
+
+
+static string
+ToStr(int val)
+{
+	ostringstream str;
+	str << val;
+	return str.str();
+}
+
+
+/****************************************
+ * Run the skeleton with one setting
+ * Output:
+ *		Result &res: from its "total:" line
+ * Return:
+ *		bool: false if it failed
+ ****************************************/
+static bool
+RunSkeleton(const string &skel, int np, const vector<string> &skelArgs,
+		const Setting &set, Result &res)
+{
+	string cmd = GetEnv("NC2ADIOS_MPIRUN", "mpirun") + " -n " + ToStr(np)
+		+ " " + ShellQuote(skel);
+
+	cmd += " -m " + ShellQuote(set.Method) + " -p " + ShellQuote(set.Params)
+		+ " -b " + ToStr(set.BufferMB) + " -s " + (set.Stats ? "on" : "off")
+		+ " -f " + ToStr(set.Flush);
+	for (vector<string>::size_type i = 0; i < skelArgs.size(); ++i)
+		cmd += " " + ShellQuote(skelArgs[i]);
+	cmd += " 2>&1";
+
+	FILE *pipe = popen(cmd.c_str(), "r");
+	if (pipe == NULL)
+		return false;
+
+	char line[1024];
+	unsigned long long bytes;
+	double sec;
+	bool found = false;
+	while (fgets(line, sizeof(line), pipe) != NULL)
+		if (sscanf(line, "total: %llu bytes in %lf s, %lf MB/s, peak %ld KB",
+				&bytes, &sec, &res.MBps, &res.PeakKB) == 4)
+			found = true;
+
+	return pclose(pipe) == 0 && found;
+}
+
+
+/****************************************
+ * Replace the tuned keys of a profile,
+ * other lines are kept
+ ****************************************/
+static void
+WriteProfile(const string &path, const Setting &set, const Result &res,
+		int np)
+{
+	ifstream in(path.c_str());
+	ostringstream text;
+	string line, key;
+
+	while (getline(in, line)) {
+		istringstream words(line.substr(0, line.find('#')));
+		if ( (words >> key) && (key == "method" || key == "method_params" ||
+				key == "buffer_mb" || key == "stats" || key == "sync") )
+			continue;
+		text << line << endl;
+	}
+	in.close();
+
+	text << "# nc2adios-tune: " << np << " ranks, " << res.MBps
+		<< " MB/s, peak " << res.PeakKB << " KB" << endl;
+	text << "method " << set.Method << endl;
+	if (!set.Params.empty())
+		text << "method_params " << set.Params << endl;
+	text << "buffer_mb " << set.BufferMB << endl;
+	text << "stats " << (set.Stats ? "on" : "off") << endl;
+	text << "sync " << (set.Flush > 0 ? "step" : "drop") << endl;
+
+	ofstream out(path.c_str());
+	out << text.str();
+}
+
+
+/****************************************
+ * Value of attribute attr of the element
+ * starting at pos, replaced by val
+ ****************************************/
+static void
+SetAttr(string &text, string::size_type pos, const string &attr,
+		const string &val)
+{
+	string::size_type end = text.find('>', pos);
+	string::size_type at = text.find(" " + attr + "=\"", pos);
+
+	if (at == string::npos || at > end)
+		return;
+	at += attr.length() + 3;
+	text.replace(at, text.find('"', at) - at, val);
+}
+
+
+/****************************************
+ * Set methods, stats and the buffer of
+ * an ADIOS XML config. The flush cadence
+ * has no XML form, it is only printed.
+ ****************************************/
+static void
+WriteXml(const string &path, const Setting &set)
+{
+	ifstream in(path.c_str());
+	stringstream buf;
+	buf << in.rdbuf();
+	in.close();
+	string text = buf.str();
+	string::size_type pos;
+
+	for (pos = text.find("<adios-group "); pos != string::npos;
+			pos = text.find("<adios-group ", pos + 1))
+		SetAttr(text, pos, "stats", set.Stats ? "On" : "Off");
+
+	for (pos = text.find("<method "); pos != string::npos;
+			pos = text.find("<method ", pos + 1)) {
+		SetAttr(text, pos, "method", set.Method);
+		string::size_type begin = text.find('>', pos) + 1;
+		string::size_type end = text.find("</method>", begin);
+		if (end != string::npos)
+			text.replace(begin, end - begin, set.Params);
+	}
+
+	pos = text.find("<buffer ");
+	if (pos != string::npos)
+		SetAttr(text, pos, "size-MB", ToStr(set.BufferMB));
+
+	ofstream out(path.c_str());
+	out << text;
+}
+
+
+static void
+Usage()
+{
+	cerr << "usage: nc2adios-tune [-n NP] [-m METHODS] [-p PARAMS] "
+		<< "[-b MBS] [-a AGGREGATORS]" << endl
+		<< "\t[-s on,off] [-f FLUSHES] [-M MB] [-o PROFILE|XML] "
+		<< "SKELETON [SKELETON ARGS]" << endl;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	int np = 4, memMB = 0, i;
+	string methods = "MPI,MPI_AGGREGATE,POSIX", params;
+	string buffers = "10,50,200", aggrs = "1,2,4", stats = "on,off";
+	string flushes = "0,1", output, skel;
+	vector<string> skelArgs;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i += 2) {
+		if (i + 1 >= argc) {
+			Usage();
+			return 1;
+		}
+		string opt = argv[i], val = argv[i+1];
+		if (opt == "-n")
+			np = atoi(val.c_str());
+		else if (opt == "-m")
+			methods = val;
+		else if (opt == "-p")
+			params = val;
+		else if (opt == "-b")
+			buffers = val;
+		else if (opt == "-a")
+			aggrs = val;
+		else if (opt == "-s")
+			stats = val;
+		else if (opt == "-f")
+			flushes = val;
+		else if (opt == "-M")
+			memMB = atoi(val.c_str());
+		else if (opt == "-o")
+			output = val;
+		else {
+			Usage();
+			return 1;
+		}
+	}
+	if (i >= argc) {
+		Usage();
+		return 1;
+	}
+	skel = argv[i];
+	skelArgs.assign(argv + i + 1, argv + argc);
+
+	/***** Every combination, aggregators only
+			for the aggregating method *****/
+	vector<Setting> setVec;
+	vector<string> methodVec = SplitList(methods);
+	vector<string> bufVec = SplitList(buffers);
+	vector<string> aggrVec = SplitList(aggrs);
+	vector<string> statsVec = SplitList(stats);
+	vector<string> flushVec = SplitList(flushes);
+	for (vector<string>::size_type m = 0; m < methodVec.size(); ++m) {
+		bool aggr = (methodVec[m] == "MPI_AGGREGATE");
+		for (vector<string>::size_type a = 0;
+				a < (aggr ? aggrVec.size() : 1); ++a)
+		for (vector<string>::size_type b = 0; b < bufVec.size(); ++b)
+		for (vector<string>::size_type s = 0; s < statsVec.size(); ++s)
+		for (vector<string>::size_type f = 0; f < flushVec.size(); ++f) {
+			Setting set;
+			set.Method = methodVec[m];
+			set.Params = params;
+			if (aggr)
+				set.Params += (params.empty() ? "" : ";") +
+					string("num_aggregators=") + aggrVec[a];
+			set.BufferMB = atoi(bufVec[b].c_str());
+			set.Stats = (statsVec[s] == "on");
+			set.Flush = atoi(flushVec[f].c_str());
+			setVec.push_back(set);
+		}
+	}
+
+	/***** Fastest within the memory limit;
+			within 5% of it, the smallest *****/
+	vector<Result> resVec(setVec.size());
+	vector<bool> okVec(setVec.size());
+	int best = -1;
+	for (vector<Setting>::size_type k = 0; k < setVec.size(); ++k) {
+		const Setting &set = setVec[k];
+		okVec[k] = RunSkeleton(skel, np, skelArgs, set, resVec[k]);
+		cout << set.Method << " \"" << set.Params << "\" buffer "
+			<< set.BufferMB << " stats " << (set.Stats ? "on" : "off")
+			<< " flush " << set.Flush << ": ";
+		if (!okVec[k]) {
+			cout << "failed" << endl;
+			continue;
+		}
+		cout << resVec[k].MBps << " MB/s, peak " << resVec[k].PeakKB
+			<< " KB" << endl;
+		if (memMB > 0 && resVec[k].PeakKB > memMB * 1024L)
+			okVec[k] = false;
+		else if (best < 0 || resVec[k].MBps > resVec[best].MBps)
+			best = k;
+	}
+	if (best < 0) {
+		cout << "ERROR: no setting ran within the limits .Quit. " << endl;
+		return 1;
+	}
+	int fastest = best;
+	for (vector<Setting>::size_type k = 0; k < setVec.size(); ++k)
+		if (okVec[k] && resVec[k].MBps >= 0.95 * resVec[fastest].MBps &&
+				resVec[k].PeakKB < resVec[best].PeakKB)
+			best = k;
+
+	const Setting &set = setVec[best];
+	cout << "best: " << set.Method << " \"" << set.Params << "\" buffer "
+		<< set.BufferMB << " stats " << (set.Stats ? "on" : "off")
+		<< " flush " << set.Flush << endl;
+
+	if (output.empty())
+		return 0;
+	if (output.length() > 4 && output.substr(output.length() - 4) == ".xml") {
+		WriteXml(output, set);
+		if (set.Flush > 0)
+			cout << "flush " << set.Flush << " needs \"sync step\" in the "
+				<< "translation profile" << endl;
+	} else {
+		WriteProfile(output, set, resVec[best], np);
+	}
+	cout << "tuned settings written to " << output << endl;
+	return 0;
+}
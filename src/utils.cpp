@@ -1,3 +1,4 @@
+#include <sstream>
 #include "utils.h"
 
 using namespace std;
@@ -32,20 +33,23 @@ Is_MPI_Comm_Declaration(SgNode *node)
 
 /*************************************
  * Return the type define declaration
- * for MPI_Comm
+ * for MPI_Comm, NULL if mpi.h was NOT 
+ * parsed
  ************************************/
 SgTypedefDeclaration *
 Get_MPI_Comm_Declaration(SgNode *node)
 {
 	static SgTypedefDeclaration *decl = NULL;
+	static bool queried = false;
 
-	if (decl == NULL) {
+	if (!queried) {
 		assert(node != NULL);
 		vector<SgNode*> vec = 
 			NodeQuery::querySubTree(node, Is_MPI_Comm_Declaration);
 		cout << "vector size: " << vec.size() << endl;
-		assert(vec.size() == 1);
-		decl = isSgTypedefDeclaration(vec[0]);
+		if (!vec.empty())
+			decl = isSgTypedefDeclaration(vec[0]);
+		queried = true;
 	}
 
 	return decl;
@@ -81,7 +85,9 @@ InsertMPI(SgProject *project)
 	/***** MPI_Comm comm = MPI_WORLD_COMM *****/
 	SgTypedefDeclaration *commTypeDecl;
 	commTypeDecl= Get_MPI_Comm_Declaration(project);
-	SgType *MPICommType = SgTypedefType::createType(commTypeDecl);
+	SgType *MPICommType = (commTypeDecl != NULL) ?
+		SgTypedefType::createType(commTypeDecl) : 
+		buildOpaqueType("MPI_Comm", getGlobalScope(body));
 	SgType *intType = buildIntType();
 
 	SgExpression *initExp = 
@@ -165,6 +171,13 @@ InitFuncNameIndMap(map<string, FUNC> &nameIndMap)
 	nameIndMap.insert(make_pair("nc_put_var_float", NC_PUT_VAR_FLOAT));
 	nameIndMap.insert(make_pair("nc_put_vara_int", NC_PUT_VARA_INT));
 	nameIndMap.insert(make_pair("nc_close", NC_CLOSE));
+	nameIndMap.insert(make_pair("nc_open_par", NC_OPEN_PAR));
+	nameIndMap.insert(make_pair("nc_inq_varid", NC_INQ_VARID));
+	nameIndMap.insert(make_pair("nc_get_vara_int", NC_GET_VARA_INT));
+	nameIndMap.insert(make_pair("nc_get_vara_float", NC_GET_VARA_FLOAT));
+	nameIndMap.insert(make_pair("nc_redef", NC_REDEF));
+	nameIndMap.insert(make_pair("nc_sync", NC_SYNC));
+	nameIndMap.insert(make_pair("nc_put_att_text", NC_PUT_ATT_TEXT));
 }
 
 
@@ -191,7 +204,8 @@ HasNcPrefix(const string &funcName)
 void
 FilterCall(Rose_STL_Container<SgNode *>&callList,
 			vector<SgFunctionCallExp *> &ncCall, 
-			const map<string, FUNC> &nameIndMap)
+			const map<string, FUNC> &nameIndMap,
+			vector<SgFunctionCallExp *> *unsupported)
 {
 
 	SgFunctionCallExp *callExp;
@@ -217,6 +231,10 @@ FilterCall(Rose_STL_Container<SgNode *>&callList,
 			ncCall.push_back(callExp);
 		} else {
 			if (HasNcPrefix(funcName)) {
+				if (unsupported != NULL) {
+					unsupported->push_back(callExp);
+					continue;
+				}
 				cout << "ERROR: unsupport NetCDF function: " << 
 					funcName << endl;
 				exit(1);
@@ -257,7 +275,7 @@ GroupNcCall(vector<SgFunctionCallExp*> &callVec,
 void
 GroupNcCallNow(vector<SgFunctionCallExp*> &callVec, 
 			vector< vector<SgFunctionCallExp*> > &callGroupVec,
-			map<SgInitializedName*, int>ncidMap)
+			const map<SgInitializedName*, int> &ncidMap)
 {
 	SgFunctionCallExp *callExp;
 	SgInitializedName *varInitName;
@@ -276,13 +294,22 @@ GroupNcCallNow(vector<SgFunctionCallExp*> &callVec,
 		funcName = GetCallName(callExp);
 		if (funcName == string("nc_create")) {
 			varInitName = ArgIntPtr_InitName(GetCallArgs(callExp)[2]); 
-		} else if (funcName == string("nc_create_par")) {
+		} else if (funcName == string("nc_create_par") ||
+				funcName == string("nc_open_par")) {
 			varInitName = ArgIntPtr_InitName(GetCallArgs(callExp)[4]); 
 		} else {
 			varInitName = ArgVarRef_InitName(GetCallArgs(callExp)[0]);
 		}
 
-		callGroupVec[ncidMap[varInitName]].push_back(callExp);
+		map<SgInitializedName*, int>::const_iterator itr = 
+			ncidMap.find(varInitName);
+		if (itr == ncidMap.end()) {
+			cout << "ERROR: ncid of " << funcName << " at line " 
+				<< GetCallFileLine(callExp) << " is NOT set by nc_create, "
+				<< "nc_create_par or nc_open_par .Quit. " << endl;
+			exit(1);
+		}
+		callGroupVec[itr->second].push_back(callExp);
 	}
 }
 
@@ -312,6 +339,7 @@ InitNcidMap(const vector<SgFunctionCallExp*>&callVec,
 
 		callExp = callVec[i];
 		funcName = GetCallName(callExp);
+		toInsert = false;
 
 		/***** Is it nc_create()? *****/
 		if ( funcName == string("nc_create") ) {
@@ -322,6 +350,11 @@ InitNcidMap(const vector<SgFunctionCallExp*>&callVec,
 		} else if ( funcName == string("nc_create_par") ) {
 			exp= GetCallArgs(callExp)[4];
 			toInsert = true;
+
+		/***** Is it nc_open_par()? *****/
+		} else if ( funcName == string("nc_open_par") ) {
+			exp= GetCallArgs(callExp)[4];
+			toInsert = true;
 		}
 		/**** Update the map *****/
 		if (toInsert) {
@@ -416,33 +449,225 @@ GetEnumIntVal(SgEnumDeclaration *decl, const string &name)
 SgEnumDeclaration *
 GetEnumDecl(const string &name)
 {
-	static vector<SgNode*> vec;
-	SgEnumDeclaration *decl;
+	static map<string, SgEnumDeclaration*> declMap;
+	static bool queried = false;
 
-	if (vec.empty()) {
+	/***** Indexed by name once, the first
+			declaration of a name wins *****/
+	if (!queried) {
 		SgProject *project = getProject();
-		vec = NodeQuery::querySubTree(project, V_SgEnumDeclaration);
+		vector<SgNode*> vec = 
+			NodeQuery::querySubTree(project, V_SgEnumDeclaration);
+		for (vector<SgNode*>::size_type i = 0; i < vec.size(); ++i) {
+			SgEnumDeclaration *decl = isSgEnumDeclaration(vec[i]);
+			declMap.insert(make_pair(decl->get_name().getString(), decl));
+		}
+		queried = true;
 	}
 
-	for (vector<SgNode*>::size_type i = 0; 
-			i < vec.size(); ++i) {
-		decl = isSgEnumDeclaration(vec[i]);
-		if (decl->get_name().getString() == name)
-			return decl;
-	}
-	return NULL;
+	map<string, SgEnumDeclaration*>::const_iterator itr = 
+		declMap.find(name);
+	return (itr == declMap.end()) ? NULL : itr->second;
 }
 
+/*****************************************
+ * Values of the ADIOS enum constants the
+ * translator emits, as in adios_types.h
+ *****************************************/
+struct AdiosEnumConst {
+	const char *Type;
+	const char *Name;
+	int Val;
+};
+
+static const AdiosEnumConst AdiosEnumTable[] = {
+	{"ADIOS_DATATYPES", "adios_byte", 0},
+	{"ADIOS_DATATYPES", "adios_short", 1},
+	{"ADIOS_DATATYPES", "adios_integer", 2},
+	{"ADIOS_DATATYPES", "adios_long", 4},
+	{"ADIOS_DATATYPES", "adios_real", 5},
+	{"ADIOS_DATATYPES", "adios_double", 6},
+	{"ADIOS_DATATYPES", "adios_long_double", 7},
+	{"ADIOS_DATATYPES", "adios_string", 9},
+	{"ADIOS_DATATYPES", "adios_complex", 10},
+	{"ADIOS_DATATYPES", "adios_double_complex", 11},
+	{"ADIOS_DATATYPES", "adios_unsigned_byte", 50},
+	{"ADIOS_DATATYPES", "adios_unsigned_short", 51},
+	{"ADIOS_DATATYPES", "adios_unsigned_integer", 52},
+	{"ADIOS_DATATYPES", "adios_unsigned_long", 54},
+	{"ADIOS_FLAG", "adios_flag_yes", 1},
+	{"ADIOS_FLAG", "adios_flag_no", 2},
+	{"ADIOS_BUFFER_ALLOC_WHEN", "ADIOS_BUFFER_ALLOC_NOW", 1},
+	{"ADIOS_BUFFER_ALLOC_WHEN", "ADIOS_BUFFER_ALLOC_LATER", 2},
+	{"ADIOS_READ_METHOD", "ADIOS_READ_METHOD_BP", 0}
+};
+
+
+/*****************************************
+ * Get the value of an ADIOS enum constant
+ * from the built-in table
+ * Return:
+ *		bool: false if it is not in the table
+ ******************************************/
+bool
+GetAdiosEnumVal(const string &enumType, const string &enumConstant,
+		int &val)
+{
+	for (size_t i = 0; 
+			i < sizeof(AdiosEnumTable)/sizeof(AdiosEnumTable[0]); ++i)
+		if (enumType == AdiosEnumTable[i].Type && 
+				enumConstant == AdiosEnumTable[i].Name) {
+			val = AdiosEnumTable[i].Val;
+			return true;
+		}
+	return false;
+}
+
+
 /*****************************************
  * Get the expression of an enum constant
+ * If adios.h was parsed, an enum value of
+ * its declaration, else a reference to
+ * the constant by name. Either way it
+ * unparses as the constant name.
  ******************************************/
 SgExpression *
 GetEnumExpr(const string &enumType, const string &enumConstant)
 {
+	int val;
+
+	if (!GetAdiosEnumVal(enumType, enumConstant, val)) {
+		cout << "ERROR: unknown ADIOS enum constant " << enumType 
+			<< "::" << enumConstant << " .Quit. " << endl;
+		exit(1);
+	}
+
 	SgEnumDeclaration *decl = GetEnumDecl(enumType);
-	assert(decl != NULL);
-	int val = GetEnumIntVal(decl, enumConstant);
-	return BuildEnumVal(val, decl, enumConstant);
+	if (decl != NULL)
+		return BuildEnumVal(val, decl, enumConstant);
+	return buildVarRefExp(SgName(enumConstant));
+}
+
+
+/*****************************************
+ * #include "adios.h" at the top of the 
+ * file of a statement, unless adios.h 
+ * was parsed already. Once per file.
+ ******************************************/
+void
+InsertAdiosHeader(SgStatement *stmt)
+{
+	static set<SgGlobal*> doneSet;
+	SgGlobal *global = getGlobalScope(stmt);
+
+	if (GetEnumDecl("ADIOS_FLAG") != NULL || 
+			!doneSet.insert(global).second)
+		return;
+	insertHeader("adios.h", PreprocessingInfo::after, false, global);
+	cout << "Inserting #include \"adios.h\"" << endl;
+}
+
+
+/*****************************************
+ * #include "nc2adios_rt.h" at the top of
+ * the file of a statement, once per file
+ ******************************************/
+void
+InsertRuntimeHeader(SgStatement *stmt)
+{
+	static set<SgGlobal*> doneSet;
+	SgGlobal *global = getGlobalScope(stmt);
+
+	if (!doneSet.insert(global).second)
+		return;
+	insertHeader("nc2adios_rt.h", PreprocessingInfo::after, false, global);
+	cout << "Inserting #include \"nc2adios_rt.h\"" << endl;
+}
+
+
+/*****************************************
+ * #include <omp.h> at the top of the file
+ * of a statement, once per file
+ ******************************************/
+void
+InsertOmpHeader(SgStatement *stmt)
+{
+	static set<SgGlobal*> doneSet;
+	SgGlobal *global = getGlobalScope(stmt);
+
+	if (!doneSet.insert(global).second)
+		return;
+	insertHeader("omp.h", PreprocessingInfo::after, true, global);
+	cout << "Inserting #include <omp.h>" << endl;
+}
+
+
+/*****************************************
+ * The pragma of a region is the statement
+ * right before it: walk up from stmt to
+ * its function looking for one
+ ******************************************/
+SgStatement *
+GetOmpRegion(SgStatement *stmt)
+{
+	for (SgStatement *s = stmt; s != NULL && !isSgFunctionDefinition(s);
+			s = isSgStatement(s->get_parent())) {
+		SgPragmaDeclaration *pragma = 
+			isSgPragmaDeclaration(getPreviousStatement(s, false));
+		if (pragma == NULL)
+			continue;
+		istringstream words(pragma->get_pragma()->get_pragma());
+		string omp, parallel;
+		if ( (words >> omp >> parallel) && omp == "omp" && 
+				parallel == "parallel" )
+			return s;
+	}
+	return NULL;
+}
+
+
+/*****************************************
+ * Argument of the num_threads clause of
+ * the pragma of a region, empty if none
+ ******************************************/
+string
+GetOmpNumThreads(SgStatement *region)
+{
+	SgPragmaDeclaration *pragma = 
+		isSgPragmaDeclaration(getPreviousStatement(region, false));
+	assert(pragma != NULL);
+	string text = pragma->get_pragma()->get_pragma();
+	string::size_type pos = text.find("num_threads");
+	if (pos == string::npos)
+		return string();
+	pos = text.find('(', pos);
+	if (pos == string::npos)
+		return string();
+
+	int depth = 0;
+	for (string::size_type end = pos; end < text.length(); ++end) {
+		if (text[end] == '(')
+			depth++;
+		else if (text[end] == ')' && --depth == 0)
+			return text.substr(pos + 1, end - pos - 1);
+	}
+	return string();
+}
+
+
+/*****************************************
+ * Loop that repeats a put: the one around
+ * its OpenMP parallel region, else the
+ * one around it
+ ******************************************/
+SgForStatement *
+GetPutLoop(SgStatement *stmt)
+{
+	SgStatement *region = GetOmpRegion(stmt);
+
+	if (region != NULL)
+		stmt = isSgStatement(region->get_parent());
+	return isSgForStatement(findEnclosingLoop(stmt));
 }
 	
 
@@ -579,16 +804,186 @@ ExtractForStmtBounds(SgForStatement *forStmt, int &low, int &high)
 
 }
 
+/*****************************************
+ * Whether ExtractForStmtBounds can handle
+ * a For Statement: i = low; i < high; i++
+ * with int literal bounds
+ *****************************************/
+bool
+IsCanonicalForStmt(SgForStatement *forStmt)
+{
+	vector<SgStatement*> initStmtVec = forStmt->get_init_stmt();
+	if (initStmtVec.size() != 1 ||
+			initStmtVec[0]->variantT() != V_SgExprStatement)
+		return false;
+
+	SgAssignOp *assOp = isSgAssignOp(
+		(static_cast<SgExprStatement*>(initStmtVec[0]))->get_expression());
+	if (assOp == NULL)
+		return false;
+	SgCastExp *r = isSgCastExp(assOp->get_rhs_operand());
+	if (r == NULL || isSgIntVal(r->get_operand()) == NULL)
+		return false;
+
+	SgExprStatement *testStmt = isSgExprStatement(forStmt->get_test());
+	if (testStmt == NULL)
+		return false;
+	SgLessThanOp *lessOp = isSgLessThanOp(testStmt->get_expression());
+	if (lessOp == NULL)
+		return false;
+	r = isSgCastExp(lessOp->get_rhs_operand());
+	if (r == NULL || isSgIntVal(r->get_operand()) == NULL)
+		return false;
+
+	return isSgPlusPlusOp(forStmt->get_increment()) != NULL;
+}
+
 string
-MakeStr(vector<string> strVec, string prefix)
+MakeStr(const vector<string> &strVec, const string &prefix)
 {
 	string str;
-	for (vector<string>::size_type i = 0; i < strVec.size()-1; i++) { 
-		str += prefix + strVec[i] + ",";
+	for (vector<string>::size_type i = 0; i < strVec.size(); i++) { 
+		if (i > 0)
+			str += ",";
+		str += prefix + strVec[i];
 	}
-	str += strVec[strVec.size()-1];
 
 	return str;
 }
 
+/*****************************************
+ * Type name in an adios XML config
+ *****************************************/
+string
+GetXmlTypeName(const string &enumConstant)
+{
+	string name = enumConstant;
+
+	if (name.compare(0, 6, "adios_") == 0)
+		name = name.substr(6);
+	for (string::size_type i = 0; i < name.length(); ++i)
+		if (name[i] == '_')
+			name[i] = ' ';
+	return name;
+}
+
+
+/*****************************************
+ * StmtBatch
+ *****************************************/
+void
+StmtBatch::InsertAfter(SgStatement *anchor, SgStatement *stmt)
+{
+	if (NewSet.find(anchor) == NewSet.end() && 
+			AfterMap.find(anchor) == AfterMap.end() &&
+			RemoveSet.find(anchor) == RemoveSet.end())
+		AnchorVec.push_back(anchor);
+
+	/***** Right after anchor, before what was
+			inserted after it earlier *****/
+	vector<SgStatement*> &vec = AfterMap[anchor];
+	vec.insert(vec.begin(), stmt);
+	NewSet.insert(stmt);
+}
+
+void
+StmtBatch::Remove(SgStatement *stmt)
+{
+	assert(NewSet.find(stmt) == NewSet.end());
+	if (AfterMap.find(stmt) == AfterMap.end() &&
+			RemoveSet.find(stmt) == RemoveSet.end())
+		AnchorVec.push_back(stmt);
+	RemoveSet.insert(stmt);
+}
+
+void
+StmtBatch::Replace(SgStatement *stmt, SgStatement *newStmt)
+{
+	InsertAfter(stmt, newStmt);
+	Remove(stmt);
+}
+
 
+/*****************************************
+ * Append stmt unless removed, then the
+ * statements inserted after it. Comments
+ * and directives of removed statements go
+ * to the next statement appended.
+ *****************************************/
+void
+StmtBatch::Emit(SgStatement *stmt, SgStatementPtrList &list, 
+	vector<SgStatement*> &orphanVec)
+{
+	if (RemoveSet.find(stmt) == RemoveSet.end()) {
+		for (vector<SgStatement*>::size_type i = 0; i < orphanVec.size(); ++i)
+			movePreprocessingInfo(orphanVec[i], stmt,
+				PreprocessingInfo::undef, PreprocessingInfo::undef, true);
+		orphanVec.clear();
+		list.push_back(stmt);
+	} else {
+		orphanVec.push_back(stmt);
+	}
+
+	map<SgStatement*, vector<SgStatement*> >::iterator itr = 
+		AfterMap.find(stmt);
+	if (itr == AfterMap.end())
+		return;
+	for (vector<SgStatement*>::size_type i = 0; i < itr->second.size(); ++i)
+		Emit(itr->second[i], list, orphanVec);
+}
+
+
+/*****************************************
+ * One pass over each block with edits;
+ * anchors outside a basic block (a loop
+ * body that is a single statement, the
+ * global scope) are edited in place
+ *****************************************/
+void
+StmtBatch::Flush()
+{
+	set<SgBasicBlock*> doneSet;
+
+	for (vector<SgStatement*>::size_type i = 0; i < AnchorVec.size(); ++i) {
+		SgBasicBlock *block = isSgBasicBlock(AnchorVec[i]->get_parent());
+
+		if (block == NULL) {
+			SgStatement *prevStmt = AnchorVec[i];
+			vector<SgStatement*> orphanVec;
+			SgStatementPtrList list;
+			Emit(AnchorVec[i], list, orphanVec);
+			for (SgStatementPtrList::size_type j = 0; j < list.size(); ++j)
+				if (list[j] != AnchorVec[i]) {
+					insertStatementAfter(prevStmt, list[j]);
+					prevStmt = list[j];
+				}
+			if (RemoveSet.find(AnchorVec[i]) != RemoveSet.end())
+				removeStatement(AnchorVec[i]);
+			continue;
+		}
+		if (!doneSet.insert(block).second)
+			continue;
+
+		SgStatementPtrList &stmtList = block->get_statements();
+		SgStatementPtrList list;
+		vector<SgStatement*> orphanVec;
+		list.reserve(stmtList.size());
+		for (SgStatementPtrList::size_type j = 0; j < stmtList.size(); ++j)
+			Emit(stmtList[j], list, orphanVec);
+		for (vector<SgStatement*>::size_type j = 0; j < orphanVec.size(); ++j)
+			if (!list.empty())
+				movePreprocessingInfo(orphanVec[j], list.back());
+
+		for (SgStatementPtrList::size_type j = 0; j < list.size(); ++j)
+			if (NewSet.find(list[j]) != NewSet.end()) {
+				list[j]->set_parent(block);
+				fixStatement(list[j], block);
+			}
+		stmtList.swap(list);
+	}
+
+	AfterMap.clear();
+	RemoveSet.clear();
+	NewSet.clear();
+	AnchorVec.clear();
+}